@@ -0,0 +1,387 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "binhex.h"
+#include "util.h"
+
+#define BINHEX_BUFFER_SIZE (64 * 1024)
+#define BINHEX_MAX_MEMORY_FORK (64 * 1024 * 1024)
+#define BINHEX_RLE_MARKER 0x90
+
+static const char *s_binHexTag = "(This file must be converted with BinHex";
+static const char *s_binHexAlphabet = "!\"#$%&'()*+,-012345689@ABCDEFGHIJKLMNPQRSTUVXYZ[`abcdefhijklmpqr";
+
+// Values for the characters that aren't part of the alphabet
+#define BINHEX_CHAR_SKIP 0x40
+#define BINHEX_CHAR_END  0x41
+#define BINHEX_CHAR_BAD  0x42
+
+struct BinHexTable {
+	BinHexTable() {
+		memset(values, BINHEX_CHAR_BAD, sizeof(values));
+
+		for (byte i = 0; i < 64; i++)
+			values[(byte)s_binHexAlphabet[i]] = i;
+
+		values[(byte)'\r'] = values[(byte)'\n'] = values[(byte)'\t'] = values[(byte)' '] = BINHEX_CHAR_SKIP;
+		values[(byte)':'] = BINHEX_CHAR_END;
+	}
+
+	byte values[256];
+};
+
+// Takes the bytes coming out of the RLE stage and splits them into the
+// header, data fork, and resource fork sections
+class BinHexDecoder {
+public:
+	BinHexDecoder(uint64 inputSize);
+	~BinHexDecoder();
+
+	bool putByte(byte b);
+	bool isDone() const { return _state == kStateDone; }
+	bool hasFailed() const { return _state == kStateFailed; }
+
+	SeekableReadStream *releaseResourceFork();
+
+private:
+	enum State {
+		kStateHeader,
+		kStateHeaderCRC,
+		kStateData,
+		kStateDataCRC,
+		kStateRsrc,
+		kStateRsrcCRC,
+		kStateDone,
+		kStateFailed
+	};
+
+	void startSection(State state, uint32 length);
+	bool checkCRC();
+	bool makeRoom();
+	bool flushSpillFile();
+
+	State _state;
+	uint32 _bytesLeft;
+	uint16 _crc;
+
+	byte _header[1 + 63 + 21];
+	uint32 _headerPos;
+	uint32 _headerLength;
+
+	uint32 _dataLength;
+	uint32 _rsrcLength;
+	uint64 _inputSize;
+	byte *_rsrc; // The whole fork, or the block waiting to go to the spill file
+	uint32 _rsrcCapacity;
+	FILE *_spillFile;
+	uint32 _rsrcPos;
+	byte _storedCRC[2];
+};
+
+BinHexDecoder::BinHexDecoder(uint64 inputSize) {
+	_state = kStateHeader;
+	_bytesLeft = 1;
+	_crc = 0;
+	_headerPos = 0;
+	_headerLength = 0;
+	_dataLength = _rsrcLength = 0;
+	_inputSize = inputSize;
+	_rsrc = 0;
+	_rsrcCapacity = 0;
+	_spillFile = 0;
+	_rsrcPos = 0;
+}
+
+BinHexDecoder::~BinHexDecoder() {
+	delete[] _rsrc;
+
+	if (_spillFile)
+		fclose(_spillFile);
+}
+
+void BinHexDecoder::startSection(State state, uint32 length) {
+	_state = state;
+	_bytesLeft = length;
+
+	if (state != kStateHeaderCRC && state != kStateDataCRC && state != kStateRsrcCRC)
+		_crc = 0;
+}
+
+bool BinHexDecoder::checkCRC() {
+	// updateCRC16() is the table driven CRC-16/XMODEM, whose result over a
+	// section is the stored CRC itself (no zero bytes to feed through)
+	return _crc == READ_UINT16_BE(_storedCRC);
+}
+
+// Called when _rsrc is full: write the block out to the spill file, or
+// grow the in-memory fork towards the length the header claims
+bool BinHexDecoder::makeRoom() {
+	if (_spillFile)
+		return flushSpillFile();
+
+	uint32 capacity = (_rsrcCapacity > _rsrcLength / 2) ? _rsrcLength : _rsrcCapacity * 2;
+	byte *rsrc = new byte[capacity];
+	memcpy(rsrc, _rsrc, _rsrcPos);
+	delete[] _rsrc;
+
+	_rsrc = rsrc;
+	_rsrcCapacity = capacity;
+	return true;
+}
+
+bool BinHexDecoder::flushSpillFile() {
+	if (fwrite(_rsrc, 1, _rsrcPos, _spillFile) != _rsrcPos)
+		return false;
+
+	_rsrcPos = 0;
+	return true;
+}
+
+bool BinHexDecoder::putByte(byte b) {
+	switch (_state) {
+	case kStateHeader:
+		_header[_headerPos++] = b;
+		_crc = updateCRC16(_crc, &b, 1);
+
+		// The first byte is the name length, which tells us the header size:
+		// name, version, type, creator, flags, data length, rsrc length
+		if (_headerPos == 1) {
+			if (b == 0 || b > 63) {
+				_state = kStateFailed;
+				return false;
+			}
+
+			_headerLength = 1 + b + 1 + 4 + 4 + 2 + 4 + 4;
+		}
+
+		if (_headerPos == _headerLength) {
+			_dataLength = READ_UINT32_BE(_header + _headerLength - 8);
+			_rsrcLength = READ_UINT32_BE(_header + _headerLength - 4);
+			startSection(kStateHeaderCRC, 2);
+		}
+		break;
+	case kStateData:
+		_crc = updateCRC16(_crc, &b, 1);
+		if (--_bytesLeft == 0)
+			startSection(kStateDataCRC, 2);
+		break;
+	case kStateRsrc:
+		_crc = updateCRC16(_crc, &b, 1);
+
+		if (_rsrcPos == _rsrcCapacity && !makeRoom()) {
+			_state = kStateFailed;
+			return false;
+		}
+
+		_rsrc[_rsrcPos++] = b;
+
+		if (--_bytesLeft == 0) {
+			if (_spillFile && !flushSpillFile()) {
+				_state = kStateFailed;
+				return false;
+			}
+
+			startSection(kStateRsrcCRC, 2);
+		}
+		break;
+	case kStateHeaderCRC:
+	case kStateDataCRC:
+	case kStateRsrcCRC:
+		_storedCRC[2 - _bytesLeft] = b;
+
+		if (--_bytesLeft != 0)
+			break;
+
+		if (!checkCRC()) {
+			_state = kStateFailed;
+			return false;
+		}
+
+		if (_state == kStateHeaderCRC) {
+			if (_rsrcLength == 0) {
+				_state = kStateFailed;
+				return false;
+			}
+
+			// Small forks go straight into memory, big ones into a temp file
+			// a block at a time. The header's length is only trusted as far
+			// as the input could plausibly back it up; past that, the
+			// buffer grows as data actually arrives.
+			if (_rsrcLength <= BINHEX_MAX_MEMORY_FORK) {
+				_rsrcCapacity = (_rsrcLength < _inputSize) ? _rsrcLength : (uint32)_inputSize;
+				if (_rsrcCapacity == 0)
+					_rsrcCapacity = 1;
+			} else if (!(_spillFile = tmpfile())) {
+				_state = kStateFailed;
+				return false;
+			} else {
+				_rsrcCapacity = BINHEX_BUFFER_SIZE;
+			}
+
+			_rsrc = new byte[_rsrcCapacity];
+
+			if (_dataLength != 0) {
+				startSection(kStateData, _dataLength);
+			} else {
+				_crc = 0;
+				startSection(kStateDataCRC, 2);
+			}
+		} else if (_state == kStateDataCRC) {
+			startSection(kStateRsrc, _rsrcLength);
+		} else {
+			_state = kStateDone;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+SeekableReadStream *BinHexDecoder::releaseResourceFork() {
+	if (_state != kStateDone)
+		return 0;
+
+	SeekableReadStream *stream;
+
+	if (_spillFile) {
+		fflush(_spillFile);
+		stream = new FileReadStream(_spillFile);
+		_spillFile = 0;
+	} else {
+		stream = new MemoryReadStream(_rsrc, _rsrcLength);
+		_rsrc = 0;
+	}
+
+	return stream;
+}
+
+// Find the tag line and the colon that starts the encoded data after it
+static bool findBinHexStart(FILE *file) {
+	char line[256];
+	uint32 bytesScanned = 0;
+	uint64 lineStart = tellFile(file);
+
+	// Don't read through an entire non-BinHex file looking for the tag
+	while (bytesScanned < BINHEX_BUFFER_SIZE && fgets(line, sizeof(line), file)) {
+		bytesScanned += strlen(line);
+
+		if (strncmp(line, s_binHexTag, strlen(s_binHexTag))) {
+			lineStart = tellFile(file);
+			continue;
+		}
+
+		// With Mac line endings, fgets() can read past the colon and into
+		// the data, so go back to just after the tag
+		if (!seekFile(file, lineStart + strlen(s_binHexTag)))
+			return false;
+
+		int c;
+		while ((c = getc(file)) != EOF)
+			if (c == ':')
+				return true;
+
+		return false;
+	}
+
+	return false;
+}
+
+SeekableReadStream *decodeBinHexResourceFork(FILE *file) {
+	static const BinHexTable table;
+
+	if (!findBinHexStart(file))
+		return 0;
+
+	// Limits how much the header alone can make the decoder allocate
+	uint64 fileSize = getFileSize(file);
+	uint64 position = tellFile(file);
+	BinHexDecoder decoder((fileSize > position) ? fileSize - position : 0);
+	byte *buffer = new byte[BINHEX_BUFFER_SIZE];
+
+	// 6-bit decoder state
+	uint32 bits = 0;
+	uint32 bitCount = 0;
+
+	// RLE state
+	byte lastByte = 0;
+	bool sawMarker = false;
+
+	bool finished = false;
+
+	while (!finished && !decoder.isDone() && !decoder.hasFailed()) {
+		uint32 bytesRead = fread(buffer, 1, BINHEX_BUFFER_SIZE, file);
+		if (bytesRead == 0)
+			break;
+
+		for (uint32 i = 0; i < bytesRead && !decoder.isDone(); i++) {
+			byte value = table.values[buffer[i]];
+
+			if (value == BINHEX_CHAR_SKIP)
+				continue;
+
+			if (value == BINHEX_CHAR_END || value == BINHEX_CHAR_BAD) {
+				finished = true;
+				break;
+			}
+
+			bits = (bits << 6) | value;
+			bitCount += 6;
+
+			if (bitCount < 8)
+				continue;
+
+			bitCount -= 8;
+			byte b = bits >> bitCount;
+
+			// Run length decoding: 0x90 <count> repeats the previous byte,
+			// with a count of zero meaning a literal 0x90
+			if (sawMarker) {
+				sawMarker = false;
+
+				if (b == 0) {
+					lastByte = BINHEX_RLE_MARKER;
+					decoder.putByte(lastByte);
+				} else {
+					for (uint32 j = 1; j < b && !decoder.isDone(); j++)
+						decoder.putByte(lastByte);
+				}
+			} else if (b == BINHEX_RLE_MARKER) {
+				sawMarker = true;
+			} else {
+				lastByte = b;
+				decoder.putByte(b);
+			}
+
+			if (decoder.hasFailed()) {
+				finished = true;
+				break;
+			}
+		}
+	}
+
+	delete[] buffer;
+	return decoder.releaseResourceFork();
+}
@@ -0,0 +1,33 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef BINHEX_H
+#define BINHEX_H
+
+#include "stream.h"
+
+// Decode the resource fork out of a BinHex 4.0 (.hqx) file in one pass,
+// checking the CRCs along the way. Large forks are spilled to a temporary
+// file instead of being held in memory. Returns 0 on failure.
+SeekableReadStream *decodeBinHexResourceFork(FILE *file);
+
+#endif
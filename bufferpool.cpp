@@ -0,0 +1,124 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <atomic>
+#include <vector>
+
+#include "bufferpool.h"
+
+// How many free buffers each thread hangs on to, and the largest one worth
+// keeping; anything bigger is a one-off
+#define MAX_POOLED_BUFFERS 4
+#define MAX_POOLED_SIZE (16 * 1024 * 1024)
+
+// Round sizes up so slightly different resources can share a buffer
+#define BUFFER_GRANULARITY (64 * 1024)
+
+static std::atomic<uint64> s_allocationCount(0);
+static std::atomic<uint64> s_reuseCount(0);
+
+struct PooledBuffer {
+	byte *data;
+	uint32 capacity;
+};
+
+struct ThreadBufferPool {
+	~ThreadBufferPool() {
+		for (uint32 i = 0; i < buffers.size(); i++)
+			delete[] buffers[i].data;
+	}
+
+	std::vector<PooledBuffer> buffers;
+};
+
+static thread_local ThreadBufferPool s_pool;
+
+byte *BufferPool::acquire(uint32 size, uint32 &capacity) {
+	std::vector<PooledBuffer> &buffers = s_pool.buffers;
+
+	// Take the smallest buffer that fits
+	uint32 best = buffers.size();
+
+	for (uint32 i = 0; i < buffers.size(); i++)
+		if (buffers[i].capacity >= size && (best == buffers.size() || buffers[i].capacity < buffers[best].capacity))
+			best = i;
+
+	if (best != buffers.size()) {
+		byte *data = buffers[best].data;
+		capacity = buffers[best].capacity;
+		buffers.erase(buffers.begin() + best);
+		s_reuseCount++;
+		return data;
+	}
+
+	capacity = size;
+	if (size <= MAX_POOLED_SIZE)
+		capacity = (size + BUFFER_GRANULARITY - 1) / BUFFER_GRANULARITY * BUFFER_GRANULARITY;
+
+	if (capacity == 0)
+		capacity = BUFFER_GRANULARITY;
+
+	s_allocationCount++;
+	return new byte[capacity];
+}
+
+void BufferPool::release(byte *buffer, uint32 capacity) {
+	if (!buffer)
+		return;
+
+	std::vector<PooledBuffer> &buffers = s_pool.buffers;
+
+	if (capacity > MAX_POOLED_SIZE) {
+		delete[] buffer;
+		return;
+	}
+
+	// Make room by dropping the smallest, which is the least likely to fit
+	if (buffers.size() == MAX_POOLED_BUFFERS) {
+		uint32 smallest = 0;
+
+		for (uint32 i = 1; i < buffers.size(); i++)
+			if (buffers[i].capacity < buffers[smallest].capacity)
+				smallest = i;
+
+		if (buffers[smallest].capacity > capacity) {
+			delete[] buffer;
+			return;
+		}
+
+		delete[] buffers[smallest].data;
+		buffers.erase(buffers.begin() + smallest);
+	}
+
+	PooledBuffer pooled;
+	pooled.data = buffer;
+	pooled.capacity = capacity;
+	buffers.push_back(pooled);
+}
+
+uint64 BufferPool::getAllocationCount() {
+	return s_allocationCount;
+}
+
+uint64 BufferPool::getReuseCount() {
+	return s_reuseCount;
+}
@@ -0,0 +1,42 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include "types.h"
+
+// Each thread keeps a few released buffers around for the next resource
+// to reuse, so bulk extraction settles into the same handful of buffers
+// instead of allocating for every resource.
+class BufferPool {
+public:
+	// capacity gets the real size of the buffer, which may be larger
+	static byte *acquire(uint32 size, uint32 &capacity);
+	static void release(byte *buffer, uint32 capacity);
+
+	// Totals over all threads
+	static uint64 getAllocationCount();
+	static uint64 getReuseCount();
+};
+
+#endif
@@ -0,0 +1,654 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <map>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "macresfork.h"
+
+#define CATALOG_MAGIC "MRVC"
+#define CATALOG_VERSION 2
+
+#define HEADER_SIZE 64
+#define FILE_ENTRY_SIZE 32
+#define POSTING_SIZE 16
+#define NAME_ENTRY_SIZE 16
+#define NAME_REF_SIZE 4
+
+#define FILE_FLAG_FORK 1
+
+// Case-insensitive ordering for resource names, which needn't be terminated
+static int compareNames(const byte *name1, uint32 length1, const byte *name2, uint32 length2) {
+	uint32 length = (length1 < length2) ? length1 : length2;
+
+	for (uint32 i = 0; i < length; i++) {
+		int difference = tolower(name1[i]) - tolower(name2[i]);
+
+		if (difference != 0)
+			return difference;
+	}
+
+	return (int)length1 - (int)length2;
+}
+
+const uint32 Catalog::NO_NAME;
+
+Catalog::Catalog() {
+	_data = 0;
+	_size = 0;
+	close();
+}
+
+Catalog::~Catalog() {
+	close();
+}
+
+bool Catalog::open(const char *fileName) {
+	close();
+
+	int fd = ::open(fileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size < HEADER_SIZE) {
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(0, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	_data = (const byte *)data;
+	_size = status.st_size;
+
+	if (memcmp(_data, CATALOG_MAGIC, 4) || READ_UINT32_LE(_data + 4) != CATALOG_VERSION) {
+		close();
+		return false;
+	}
+
+	_fileCount = READ_UINT32_LE(_data + 8);
+	_postingCount = READ_UINT32_LE(_data + 12);
+	_nameCount = READ_UINT32_LE(_data + 16);
+
+	uint64 filesOffset = READ_UINT64_LE(_data + 24);
+	uint64 postingsOffset = READ_UINT64_LE(_data + 32);
+	uint64 namesOffset = READ_UINT64_LE(_data + 40);
+	uint64 nameRefsOffset = READ_UINT64_LE(_data + 48);
+	uint64 stringsOffset = READ_UINT64_LE(_data + 56);
+
+	// Every table has to fit before the next one. Checking the offsets against
+	// the size first keeps the sums below from wrapping around.
+	if (filesOffset > _size || postingsOffset > _size || namesOffset > _size || nameRefsOffset > _size ||
+			filesOffset + (uint64)_fileCount * FILE_ENTRY_SIZE > postingsOffset ||
+			postingsOffset + (uint64)_postingCount * POSTING_SIZE > namesOffset ||
+			namesOffset + (uint64)_nameCount * NAME_ENTRY_SIZE > nameRefsOffset ||
+			nameRefsOffset > stringsOffset || stringsOffset > _size || filesOffset < HEADER_SIZE) {
+		close();
+		return false;
+	}
+
+	_files = _data + filesOffset;
+	_postings = _data + postingsOffset;
+	_names = _data + namesOffset;
+	_nameRefs = _data + nameRefsOffset;
+	_nameRefCount = (stringsOffset - nameRefsOffset) / NAME_REF_SIZE;
+	_strings = _data + stringsOffset;
+	_stringSize = _size - stringsOffset;
+	return true;
+}
+
+void Catalog::close() {
+	if (_data)
+		munmap((void *)_data, _size);
+
+	_data = 0;
+	_size = 0;
+	_fileCount = _postingCount = _nameCount = _nameRefCount = 0;
+	_files = _postings = _names = _nameRefs = _strings = 0;
+	_stringSize = 0;
+}
+
+std::string Catalog::getFilePath(uint32 fileIndex) const {
+	if (fileIndex >= _fileCount)
+		return std::string();
+
+	const byte *entry = _files + fileIndex * FILE_ENTRY_SIZE;
+	uint32 offset = READ_UINT32_LE(entry);
+	uint32 length = READ_UINT32_LE(entry + 4);
+
+	if ((uint64)offset + length > _stringSize)
+		return std::string();
+
+	return std::string((const char *)_strings + offset, length);
+}
+
+uint64 Catalog::getFileSize(uint32 fileIndex) const {
+	return (fileIndex < _fileCount) ? READ_UINT64_LE(_files + fileIndex * FILE_ENTRY_SIZE + 8) : 0;
+}
+
+int64 Catalog::getFileModTime(uint32 fileIndex) const {
+	return (fileIndex < _fileCount) ? (int64)READ_UINT64_LE(_files + fileIndex * FILE_ENTRY_SIZE + 16) : 0;
+}
+
+bool Catalog::isFileFork(uint32 fileIndex) const {
+	return fileIndex < _fileCount && (READ_UINT32_LE(_files + fileIndex * FILE_ENTRY_SIZE + 24) & FILE_FLAG_FORK) != 0;
+}
+
+const byte *Catalog::getPostingData(uint32 postingIndex) const {
+	return _postings + postingIndex * POSTING_SIZE;
+}
+
+Catalog::Posting Catalog::getPosting(uint32 postingIndex) const {
+	const byte *data = getPostingData(postingIndex);
+
+	Posting posting;
+	posting.tag = READ_UINT32_LE(data);
+	posting.id = READ_UINT16_LE(data + 4);
+	posting.attributes = data[6];
+	posting.fileIndex = READ_UINT32_LE(data + 8);
+	posting.nameIndex = READ_UINT32_LE(data + 12);
+	return posting;
+}
+
+std::string Catalog::getName(uint32 nameIndex) const {
+	if (nameIndex >= _nameCount)
+		return std::string();
+
+	const byte *entry = _names + nameIndex * NAME_ENTRY_SIZE;
+	uint32 offset = READ_UINT32_LE(entry);
+	uint32 length = READ_UINT32_LE(entry + 4);
+
+	if ((uint64)offset + length > _stringSize)
+		return std::string();
+
+	return std::string((const char *)_strings + offset, length);
+}
+
+// Postings are sorted by (tag << 16 | id), so a masked key picks out a run
+void Catalog::findPostingRange(uint64 key, uint64 keyMask, uint32 &first, uint32 &last) const {
+	uint32 low = 0, high = _postingCount;
+
+	while (low < high) {
+		uint32 middle = low + (high - low) / 2;
+		const byte *data = getPostingData(middle);
+
+		if ((((uint64)READ_UINT32_LE(data) << 16 | READ_UINT16_LE(data + 4)) & keyMask) < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	first = low;
+	high = _postingCount;
+
+	while (low < high) {
+		uint32 middle = low + (high - low) / 2;
+		const byte *data = getPostingData(middle);
+
+		if ((((uint64)READ_UINT32_LE(data) << 16 | READ_UINT16_LE(data + 4)) & keyMask) <= key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	last = low;
+}
+
+std::vector<uint32> Catalog::findByTag(uint32 tag) const {
+	uint32 first, last;
+	findPostingRange((uint64)tag << 16, ~(uint64)0xffff, first, last);
+
+	std::vector<uint32> result;
+	for (uint32 i = first; i < last; i++)
+		result.push_back(i);
+
+	return result;
+}
+
+std::vector<uint32> Catalog::findByTagAndID(uint32 tag, uint16 id) const {
+	uint32 first, last;
+	findPostingRange((uint64)tag << 16 | id, ~(uint64)0, first, last);
+
+	std::vector<uint32> result;
+	for (uint32 i = first; i < last; i++)
+		result.push_back(i);
+
+	return result;
+}
+
+std::vector<uint32> Catalog::findByID(uint16 id) const {
+	// IDs are spread over every type, so this one is a scan
+	std::vector<uint32> result;
+
+	for (uint32 i = 0; i < _postingCount; i++)
+		if (READ_UINT16_LE(getPostingData(i) + 4) == id)
+			result.push_back(i);
+
+	return result;
+}
+
+std::vector<uint32> Catalog::findByName(const std::string &name) const {
+	const byte *key = (const byte *)name.c_str();
+	uint32 low = 0, high = _nameCount;
+
+	// Find the first name not less than the key
+	while (low < high) {
+		uint32 middle = low + (high - low) / 2;
+		const byte *entry = _names + middle * NAME_ENTRY_SIZE;
+		uint32 offset = READ_UINT32_LE(entry);
+		uint32 length = READ_UINT32_LE(entry + 4);
+
+		if ((uint64)offset + length > _stringSize || compareNames(_strings + offset, length, key, name.size()) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	// Names differing only in case sit next to each other
+	std::vector<uint32> result;
+
+	for (; low < _nameCount; low++) {
+		const byte *entry = _names + low * NAME_ENTRY_SIZE;
+		uint32 offset = READ_UINT32_LE(entry);
+		uint32 length = READ_UINT32_LE(entry + 4);
+
+		if ((uint64)offset + length > _stringSize || compareNames(_strings + offset, length, key, name.size()) != 0)
+			break;
+
+		uint32 firstRef = READ_UINT32_LE(entry + 8);
+		uint32 refCount = READ_UINT32_LE(entry + 12);
+
+		for (uint32 i = 0; i < refCount && (uint64)firstRef + i < _nameRefCount; i++) {
+			uint32 postingIndex = READ_UINT32_LE(_nameRefs + (firstRef + i) * NAME_REF_SIZE);
+
+			if (postingIndex < _postingCount)
+				result.push_back(postingIndex);
+		}
+	}
+
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+void Catalog::getFiles(std::vector<CatalogFile> &files) const {
+	files.resize(_fileCount);
+
+	for (uint32 i = 0; i < _fileCount; i++) {
+		files[i].path = getFilePath(i);
+		files[i].size = getFileSize(i);
+		files[i].modTime = getFileModTime(i);
+		files[i].isFork = isFileFork(i);
+		files[i].resources.clear();
+	}
+
+	for (uint32 i = 0; i < _postingCount; i++) {
+		Posting posting = getPosting(i);
+
+		if (posting.fileIndex >= _fileCount)
+			continue;
+
+		CatalogResource resource;
+		resource.tag = posting.tag;
+		resource.id = posting.id;
+		resource.attributes = posting.attributes;
+
+		if (posting.nameIndex != NO_NAME)
+			resource.name = getName(posting.nameIndex);
+
+		files[posting.fileIndex].resources.push_back(resource);
+	}
+}
+
+struct PendingPosting {
+	uint32 tag;
+	uint16 id;
+	byte attributes;
+	uint32 fileIndex;
+	const std::string *name; // 0 if none
+};
+
+static bool comparePostings(const PendingPosting &p1, const PendingPosting &p2) {
+	if (p1.tag != p2.tag)
+		return p1.tag < p2.tag;
+
+	if (p1.id != p2.id)
+		return p1.id < p2.id;
+
+	return p1.fileIndex < p2.fileIndex;
+}
+
+typedef std::map<std::string, std::vector<uint32> > NameMap;
+
+static bool compareNameEntries(NameMap::const_iterator it1, NameMap::const_iterator it2) {
+	int difference = compareNames((const byte *)it1->first.c_str(), it1->first.size(), (const byte *)it2->first.c_str(), it2->first.size());
+
+	if (difference != 0)
+		return difference < 0;
+
+	return it1->first < it2->first;
+}
+
+bool writeCatalog(FILE *output, const std::vector<CatalogFile> &files) {
+	std::vector<PendingPosting> postings;
+
+	for (uint32 i = 0; i < files.size(); i++) {
+		for (uint32 j = 0; j < files[i].resources.size(); j++) {
+			const CatalogResource &resource = files[i].resources[j];
+
+			PendingPosting posting;
+			posting.tag = resource.tag;
+			posting.id = resource.id;
+			posting.attributes = resource.attributes;
+			posting.fileIndex = i;
+			posting.name = resource.name.empty() ? 0 : &resource.name;
+			postings.push_back(posting);
+		}
+	}
+
+	std::sort(postings.begin(), postings.end(), comparePostings);
+
+	// Gather each distinct name's postings, then order the names for lookup
+	NameMap nameMap;
+	for (uint32 i = 0; i < postings.size(); i++)
+		if (postings[i].name)
+			nameMap[*postings[i].name].push_back(i);
+
+	std::vector<NameMap::const_iterator> names;
+	for (NameMap::const_iterator it = nameMap.begin(); it != nameMap.end(); it++)
+		names.push_back(it);
+
+	std::sort(names.begin(), names.end(), compareNameEntries);
+
+	std::vector<uint32> postingNames(postings.size(), Catalog::NO_NAME);
+	for (uint32 i = 0; i < names.size(); i++)
+		for (uint32 j = 0; j < names[i]->second.size(); j++)
+			postingNames[names[i]->second[j]] = i;
+
+	uint32 nameRefCount = 0;
+	for (uint32 i = 0; i < names.size(); i++)
+		nameRefCount += names[i]->second.size();
+
+	uint64 filesOffset = HEADER_SIZE;
+	uint64 postingsOffset = filesOffset + (uint64)files.size() * FILE_ENTRY_SIZE;
+	uint64 namesOffset = postingsOffset + (uint64)postings.size() * POSTING_SIZE;
+	uint64 nameRefsOffset = namesOffset + (uint64)names.size() * NAME_ENTRY_SIZE;
+	uint64 stringsOffset = nameRefsOffset + (uint64)nameRefCount * NAME_REF_SIZE;
+
+	uint64 totalStringSize = 0;
+	for (uint32 i = 0; i < files.size(); i++)
+		totalStringSize += files[i].path.size();
+	for (uint32 i = 0; i < names.size(); i++)
+		totalStringSize += names[i]->first.size();
+
+	if (totalStringSize > 0xffffffff) {
+		fprintf(stderr, "Too many file and resource names for one catalog\n");
+		return false;
+	}
+
+	fwrite(CATALOG_MAGIC, 1, 4, output);
+	writeUint32LE(output, CATALOG_VERSION);
+	writeUint32LE(output, files.size());
+	writeUint32LE(output, postings.size());
+	writeUint32LE(output, names.size());
+	writeUint32LE(output, 0);
+	writeUint64LE(output, filesOffset);
+	writeUint64LE(output, postingsOffset);
+	writeUint64LE(output, namesOffset);
+	writeUint64LE(output, nameRefsOffset);
+	writeUint64LE(output, stringsOffset);
+
+	uint32 stringSize = 0;
+
+	for (uint32 i = 0; i < files.size(); i++) {
+		writeUint32LE(output, stringSize);
+		writeUint32LE(output, files[i].path.size());
+		writeUint64LE(output, files[i].size);
+		writeUint64LE(output, files[i].modTime);
+		writeUint32LE(output, files[i].isFork ? FILE_FLAG_FORK : 0);
+		writeUint32LE(output, 0);
+		stringSize += files[i].path.size();
+	}
+
+	for (uint32 i = 0; i < postings.size(); i++) {
+		writeUint32LE(output, postings[i].tag);
+		writeUint16LE(output, postings[i].id);
+		writeByte(output, postings[i].attributes);
+		writeByte(output, 0);
+		writeUint32LE(output, postings[i].fileIndex);
+		writeUint32LE(output, postingNames[i]);
+	}
+
+	uint32 nameRef = 0;
+
+	for (uint32 i = 0; i < names.size(); i++) {
+		writeUint32LE(output, stringSize);
+		writeUint32LE(output, names[i]->first.size());
+		writeUint32LE(output, nameRef);
+		writeUint32LE(output, names[i]->second.size());
+		stringSize += names[i]->first.size();
+		nameRef += names[i]->second.size();
+	}
+
+	for (uint32 i = 0; i < names.size(); i++)
+		for (uint32 j = 0; j < names[i]->second.size(); j++)
+			writeUint32LE(output, names[i]->second[j]);
+
+	for (uint32 i = 0; i < files.size(); i++)
+		fwrite(files[i].path.c_str(), 1, files[i].path.size(), output);
+
+	for (uint32 i = 0; i < names.size(); i++)
+		fwrite(names[i]->first.c_str(), 1, names[i]->first.size(), output);
+
+	return !ferror(output);
+}
+
+static void listFiles(const std::string &rootPath, const std::string &skipPath, std::vector<std::string> &paths) {
+	// The same file can be spelled many ways, so compare what it is instead
+	struct stat skipStatus;
+	bool hasSkip = !skipPath.empty() && stat(skipPath.c_str(), &skipStatus) == 0;
+	std::string skipName = skipPath.substr(skipPath.find_last_of('/') + 1);
+
+	std::vector<std::string> directories;
+	directories.push_back(rootPath);
+
+	while (!directories.empty()) {
+		std::string directory = directories.back();
+		directories.pop_back();
+
+		DIR *dir = opendir(directory.c_str());
+		if (!dir) {
+			fprintf(stderr, "Failed to open directory '%s'\n", directory.c_str());
+			continue;
+		}
+
+		std::string prefix = directory;
+		if (prefix.empty() || prefix[prefix.size() - 1] != '/')
+			prefix += '/';
+
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != 0) {
+			if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+				continue;
+
+			std::string path = prefix + entry->d_name;
+			unsigned char type = entry->d_type;
+
+			// Not every file system fills in the type
+			if (type == DT_UNKNOWN) {
+				struct stat status;
+				if (lstat(path.c_str(), &status) != 0)
+					continue;
+
+				if (S_ISDIR(status.st_mode))
+					type = DT_DIR;
+				else if (S_ISREG(status.st_mode))
+					type = DT_REG;
+			}
+
+			// Symlinks are left alone, so loops can't happen
+			if (type == DT_DIR) {
+				directories.push_back(path);
+			} else if (type == DT_REG) {
+				struct stat status;
+				if (hasSkip && skipName == entry->d_name && lstat(path.c_str(), &status) == 0 &&
+						status.st_dev == skipStatus.st_dev && status.st_ino == skipStatus.st_ino)
+					continue;
+
+				paths.push_back(path);
+			}
+		}
+
+		closedir(dir);
+	}
+
+	std::sort(paths.begin(), paths.end());
+}
+
+struct IndexJob {
+	const std::vector<std::string> *paths;
+	std::vector<CatalogFile> *files;
+	const std::map<std::string, uint32> *previousIndex;
+	const std::vector<CatalogFile> *previousFiles;
+	std::atomic<uint32> nextPath;
+	std::atomic<uint32> reusedCount;
+	std::atomic<uint32> parsedCount;
+	std::atomic<uint32> nonForkCount;
+};
+
+static void indexFiles(IndexJob *job) {
+	for (;;) {
+		uint32 i = job->nextPath++;
+		if (i >= job->paths->size())
+			break;
+
+		CatalogFile &file = (*job->files)[i];
+		file.path = (*job->paths)[i];
+		file.size = 0;
+		file.modTime = 0;
+		file.isFork = false;
+
+		struct stat status;
+		if (stat(file.path.c_str(), &status) == 0) {
+			file.size = status.st_size;
+#ifdef __APPLE__
+			file.modTime = (int64)status.st_mtimespec.tv_sec * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+			file.modTime = (int64)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+		}
+
+		std::map<std::string, uint32>::const_iterator previous = job->previousIndex->find(file.path);
+
+		if (previous != job->previousIndex->end()) {
+			const CatalogFile &previousFile = (*job->previousFiles)[previous->second];
+
+			if (previousFile.size == file.size && previousFile.modTime == file.modTime) {
+				file.isFork = previousFile.isFork;
+				file.resources = previousFile.resources;
+
+				if (file.isFork)
+					job->reusedCount++;
+				else
+					job->nonForkCount++;
+
+				continue;
+			}
+		}
+
+		ResourceFork resFork;
+		if (!resFork.load(file.path.c_str())) {
+			job->nonForkCount++;
+			continue;
+		}
+
+		file.isFork = true;
+		const std::vector<ResourceForkType> &types = resFork.getTypes();
+
+		for (uint32 j = 0; j < types.size(); j++) {
+			for (uint32 k = 0; k < types[j].ids.size(); k++) {
+				CatalogResource resource;
+				resource.tag = types[j].tag;
+				resource.id = types[j].ids[k].id;
+				resource.attributes = types[j].ids[k].attributes;
+				resource.name = types[j].ids[k].filename;
+				file.resources.push_back(resource);
+			}
+		}
+
+		job->parsedCount++;
+	}
+}
+
+void indexDirectory(const std::string &rootPath, const std::string &skipPath, const Catalog &previous, uint jobCount, std::vector<CatalogFile> &files, IndexStats &stats) {
+	std::vector<std::string> paths;
+	listFiles(rootPath, skipPath, paths);
+
+	std::vector<CatalogFile> previousFiles;
+	previous.getFiles(previousFiles);
+
+	std::map<std::string, uint32> previousIndex;
+	for (uint32 i = 0; i < previousFiles.size(); i++)
+		previousIndex[previousFiles[i].path] = i;
+
+	files.clear();
+	files.resize(paths.size());
+
+	IndexJob job;
+	job.paths = &paths;
+	job.files = &files;
+	job.previousIndex = &previousIndex;
+	job.previousFiles = &previousFiles;
+	job.nextPath = 0;
+	job.reusedCount = 0;
+	job.parsedCount = 0;
+	job.nonForkCount = 0;
+
+	if (jobCount > paths.size())
+		jobCount = paths.size();
+
+	std::vector<std::thread> threads;
+	for (uint i = 1; i < jobCount; i++)
+		threads.push_back(std::thread(indexFiles, &job));
+
+	indexFiles(&job);
+
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	stats.reusedCount = job.reusedCount;
+	stats.parsedCount = job.parsedCount;
+	stats.nonForkCount = job.nonForkCount;
+}
@@ -0,0 +1,132 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "types.h"
+
+// A catalog records the resource maps of every fork under a directory tree,
+// so lookups by type/ID or by name don't have to touch the forks at all.
+//
+// The file is little-endian and meant to be mapped and used in place:
+//
+//   header    "MRVC", version, counts, and the offsets of the tables below
+//   files     path (into the string pool), size, modification time, flags
+//   postings  tag, id, attributes, file index, name index; sorted by
+//             (tag, id, file) so type and type/ID lookups are binary searches
+//   names     string pool offset, length, and a run of name references;
+//             sorted case-insensitively for name lookups
+//   name refs posting indices for each name, in name order
+//   strings   paths and resource names
+
+struct CatalogResource {
+	uint32 tag;
+	uint16 id;
+	byte attributes;
+	std::string name;
+};
+
+struct CatalogFile {
+	std::string path;
+	uint64 size;
+	int64 modTime;
+	bool isFork; // False if ResourceFork couldn't load it
+	std::vector<CatalogResource> resources;
+};
+
+// Read-only view of a catalog file
+class Catalog {
+public:
+	Catalog();
+	~Catalog();
+
+	bool open(const char *fileName);
+	void close();
+	bool isOpen() const { return _data != 0; }
+
+	uint32 getFileCount() const { return _fileCount; }
+	std::string getFilePath(uint32 fileIndex) const;
+	uint64 getFileSize(uint32 fileIndex) const;
+	int64 getFileModTime(uint32 fileIndex) const;
+	bool isFileFork(uint32 fileIndex) const;
+
+	struct Posting {
+		uint32 tag;
+		uint16 id;
+		byte attributes;
+		uint32 fileIndex;
+		uint32 nameIndex; // NO_NAME if the resource has none
+	};
+
+	uint32 getPostingCount() const { return _postingCount; }
+	Posting getPosting(uint32 postingIndex) const;
+	std::string getName(uint32 nameIndex) const;
+
+	// All return posting indices
+	std::vector<uint32> findByTag(uint32 tag) const;
+	std::vector<uint32> findByTagAndID(uint32 tag, uint16 id) const;
+	std::vector<uint32> findByID(uint16 id) const;
+	std::vector<uint32> findByName(const std::string &name) const; // Ignoring case
+
+	// Turn the catalog back into files, for updating it
+	void getFiles(std::vector<CatalogFile> &files) const;
+
+	static const uint32 NO_NAME = 0xffffffff;
+
+private:
+	const byte *getPostingData(uint32 postingIndex) const;
+	void findPostingRange(uint64 key, uint64 keyMask, uint32 &first, uint32 &last) const;
+
+	const byte *_data;
+	uint64 _size;
+
+	uint32 _fileCount;
+	uint32 _postingCount;
+	uint32 _nameCount;
+	uint32 _nameRefCount;
+	const byte *_files;
+	const byte *_postings;
+	const byte *_names;
+	const byte *_nameRefs;
+	const byte *_strings;
+	uint64 _stringSize;
+};
+
+bool writeCatalog(FILE *output, const std::vector<CatalogFile> &files);
+
+struct IndexStats {
+	uint32 reusedCount;   // Forks unchanged since the previous catalog
+	uint32 parsedCount;
+	uint32 nonForkCount;  // Not something ResourceFork could load, then or now
+};
+
+// Walk rootPath and record every file in it except skipPath (the catalog
+// itself, if it lives inside the tree). Files whose size and modification
+// time match their entry in previous (which may be closed) are carried over
+// without being opened.
+void indexDirectory(const std::string &rootPath, const std::string &skipPath, const Catalog &previous, uint jobCount, std::vector<CatalogFile> &files, IndexStats &stats);
+
+#endif
@@ -0,0 +1,471 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+// The algorithms behind the 'dcmp' resources were never documented by
+// Apple; this follows the reverse engineered descriptions around.
+
+#include <string.h>
+#include <vector>
+
+#include "dcmp.h"
+#include "util.h"
+
+#define COMPRESSED_RESOURCE_TAG 0xA89F6572
+#define COMPRESSED_HEADER_SIZE  18
+
+// The repeat codes take a 32-bit count, so a handful of bytes can expand
+// to any size at all; all there is to go on is that System 7 never
+// produced resources anywhere near this big
+#define MAX_DECOMPRESSED_SIZE   (256 * 1024 * 1024)
+
+// Two-byte sequences common in 68k code, referenced by 0x4B-0xFD in 'dcmp' (0)
+static const uint16 s_dcmp0Table[] = {
+	0x0000, 0x4EBA, 0x0008, 0x4E75, 0x000C, 0x4EAD, 0x2053, 0x2F0B,
+	0x6100, 0x0010, 0x7000, 0x2F00, 0x486E, 0x2050, 0x206E, 0x2F2E,
+	0xFFFC, 0x48E7, 0x3F3C, 0x0004, 0xFFF8, 0x2F0C, 0x2006, 0x4EED,
+	0x4E56, 0x2068, 0x4E5E, 0x0001, 0x588F, 0x4FEF, 0x0002, 0x0018,
+	0x6000, 0xFFFF, 0x508F, 0x4E90, 0x0006, 0x266E, 0x0014, 0xFFF4,
+	0x4CEE, 0x000A, 0x000E, 0x41EE, 0x4CDF, 0x48C0, 0xFFF0, 0x2D40,
+	0x0012, 0x302E, 0x7001, 0x2F28, 0x2054, 0x6700, 0x0020, 0x001C,
+	0x205F, 0x1800, 0x266F, 0x4878, 0x0016, 0x41FA, 0x303C, 0x2840,
+	0x7200, 0x286E, 0x200C, 0x6600, 0x206B, 0x2F07, 0x558F, 0x0028,
+	0xFFFE, 0xFFEC, 0x22D8, 0x200B, 0x000F, 0x598F, 0x2F3C, 0xFF00,
+	0x0118, 0x81E1, 0x4A00, 0x4EB0, 0xFFE8, 0x48C7, 0x0003, 0x0022,
+	0x0007, 0x001A, 0x6706, 0x6708, 0x4EF9, 0x0024, 0x2078, 0x0800,
+	0x6604, 0x002A, 0x4ED0, 0x3028, 0x265F, 0x6704, 0x0030, 0x43EE,
+	0x3F00, 0x201F, 0x001E, 0xFFF6, 0x202E, 0x42A7, 0x2007, 0xFFFA,
+	0x6002, 0x3D40, 0x0C40, 0x6606, 0x0026, 0x2D48, 0x2F01, 0x70FF,
+	0x6004, 0x1880, 0x4A40, 0x0040, 0x002C, 0x2F08, 0x0011, 0xFFE4,
+	0x2140, 0x2640, 0xFFF2, 0x426E, 0x4EB9, 0x3D7C, 0x0038, 0x000D,
+	0x6006, 0x422E, 0x203C, 0x670C, 0x2D68, 0x6608, 0x4A2E, 0x4AAE,
+	0x002E, 0x4840, 0x225F, 0x2200, 0x670A, 0x3007, 0x4267, 0x0032,
+	0x2028, 0x0009, 0x487A, 0x0200, 0x2F2B, 0x0005, 0x226E, 0x6602,
+	0xE580, 0x670E, 0x660A, 0x0050, 0x3E00, 0x660C, 0x2E00, 0xFFEE,
+	0x206D, 0x2040, 0xFFE0, 0x5340, 0x6008, 0x0480, 0x0068, 0x0B7C,
+	0x4400, 0x41E8, 0x4941
+};
+
+// Referenced by 0xD5-0xFD in 'dcmp' (1)
+static const uint16 s_dcmp1Table[] = {
+	0x0000, 0x0001, 0x0002, 0x0003, 0x2E01, 0x3E01, 0x0101, 0x1E01,
+	0xFFFF, 0x0E01, 0x3100, 0x1112, 0x0107, 0x3332, 0x1239, 0xED10,
+	0x0127, 0x2322, 0x0137, 0x0706, 0x0117, 0x0123, 0x00FF, 0x002F,
+	0x070E, 0xFD3C, 0x0135, 0x0115, 0x0102, 0x0007, 0x003E, 0x05D5,
+	0x0201, 0x0607, 0x0708, 0x3001, 0x0133, 0x0010, 0x1716, 0x373E,
+	0x3637
+};
+
+// Used by 'dcmp' (2) when the resource doesn't bring its own table
+static const uint16 s_dcmp2DefaultTable[] = {
+	0x0000, 0x0008, 0x4EBA, 0x206E, 0x4E75, 0x000C, 0x0004, 0x7000,
+	0x0010, 0x0002, 0x486E, 0xFFFC, 0x6000, 0x0001, 0x48E7, 0x2F2E,
+	0x4E56, 0x0006, 0x4E5E, 0x2F00, 0x6100, 0xFFF8, 0x2F0B, 0xFFFF,
+	0x0014, 0x000A, 0x0018, 0x205F, 0x000E, 0x2050, 0x3F3C, 0xFFF4,
+	0x4CEE, 0x302E, 0x6700, 0x4CDF, 0x266E, 0x0012, 0x001C, 0x4267,
+	0xFFF0, 0x303C, 0x2F0C, 0x0003, 0x4ED0, 0x0020, 0x7001, 0x0016,
+	0x2D40, 0x48C0, 0x2078, 0x7200, 0x588F, 0x6600, 0x4FEF, 0x42A7,
+	0x6706, 0xFFFA, 0x558F, 0x286E, 0x3F00, 0xFFFE, 0x2F3C, 0x6704,
+	0x598F, 0x206B, 0x0024, 0x201F, 0x41FA, 0x81E1, 0x6604, 0x6708,
+	0x001A, 0x4EB9, 0x508F, 0x202E, 0x0007, 0x4EB0, 0xFFF2, 0x3D40,
+	0x001E, 0x2068, 0x6606, 0xFFF6, 0x4EF9, 0x0800, 0x0C40, 0x3D7C,
+	0xFFEC, 0x0005, 0x203C, 0xFFE8, 0xDEFC, 0x4A2E, 0x0030, 0x0028,
+	0x2F08, 0x200B, 0x6002, 0x426E, 0x2D48, 0x2053, 0x2040, 0x1800,
+	0x6004, 0x41EE, 0x2F28, 0x2F01, 0x670A, 0x4840, 0x2007, 0x6608,
+	0x0118, 0x2F07, 0x3028, 0x3F2E, 0x302B, 0x226E, 0x2F2B, 0x002C,
+	0x670C, 0x225F, 0x6006, 0x00FF, 0x3007, 0xFFEE, 0x5340, 0x0040,
+	0xFFE4, 0x4A40, 0x660A, 0x000F, 0x4EAD, 0x70FF, 0x22D8, 0x486B,
+	0x0022, 0x204B, 0x670E, 0x4AAE, 0x4E90, 0xFFE0, 0xFFC0, 0x002A,
+	0x2740, 0x6702, 0x51C8, 0x02B6, 0x487A, 0x2278, 0xB06E, 0xFFE6,
+	0x0009, 0x322E, 0x3E00, 0x4841, 0xFFEA, 0x43EE, 0x4E71, 0x7400,
+	0x2F2C, 0x206C, 0x003C, 0x0026, 0x0050, 0x1880, 0x301F, 0x2200,
+	0x660C, 0xFFDA, 0x0038, 0x6602, 0x302C, 0x200C, 0x2D6E, 0x4240,
+	0xFFE2, 0xA9F0, 0xFF00, 0x377C, 0xE580, 0xFFDC, 0x4868, 0x594F,
+	0x0034, 0x3E1F, 0x6008, 0x2F06, 0xFFDE, 0x600A, 0x7002, 0x0032,
+	0xFFCC, 0x0080, 0x2251, 0x101F, 0x317C, 0xA029, 0xFFD8, 0x5240,
+	0x0100, 0x6710, 0xA023, 0xFFCE, 0xFFD4, 0x2006, 0x4878, 0x002E,
+	0x504F, 0x43FA, 0x6712, 0x7600, 0x41E8, 0x4A6E, 0x20D9, 0x005A,
+	0x7FFF, 0x51CA, 0x005C, 0x2E00, 0x0240, 0x48C7, 0x6714, 0x0C80,
+	0x2E9F, 0xFFD6, 0x8000, 0x1000, 0x4842, 0x4A6B, 0xFFD2, 0x0048,
+	0x4A47, 0x4ED1, 0x206F, 0x0041, 0x600C, 0x2A78, 0x422E, 0x3200,
+	0x6574, 0x6716, 0x0044, 0x486D, 0x2008, 0x486C, 0x0B7C, 0x2640,
+	0x0400, 0x0068, 0x206D, 0x000D, 0x2A40, 0x000B, 0x003E, 0x0220
+};
+
+class Decompressor {
+public:
+	Decompressor(const byte *src, uint32 srcLength, byte *dst, uint32 dstLength);
+
+	bool decompress0();
+	bool decompress1();
+	bool decompress2(byte tableCount, byte flags);
+
+private:
+	bool finish() const { return !_error && _dst == _dstEnd; }
+
+	byte readByte();
+	int32 readVarInt();
+
+	void write(const void *data, uint32 length);
+	void writeUint16BE(uint16 x);
+	void writeUint32BE(uint32 x);
+	void writeLiteral(uint32 length, bool store);
+	void writeStoredLiteral(uint32 index);
+	void writeRepeat(uint32 value, uint32 valueLength);
+	bool doExtendedCode(byte code);
+
+	const byte *_src;
+	const byte *_srcEnd;
+	byte *_dstStart;
+	byte *_dst;
+	byte *_dstEnd;
+	bool _error;
+
+	// Earlier literals that later codes can refer back to, as (offset, length)
+	// into the output. They never get copied anywhere else.
+	std::vector<std::pair<uint32, uint32> > _literals;
+};
+
+Decompressor::Decompressor(const byte *src, uint32 srcLength, byte *dst, uint32 dstLength) {
+	_src = src;
+	_srcEnd = src + srcLength;
+	_dstStart = _dst = dst;
+	_dstEnd = dst + dstLength;
+	_error = false;
+}
+
+byte Decompressor::readByte() {
+	if (_src == _srcEnd) {
+		_error = true;
+		return 0;
+	}
+
+	return *_src++;
+}
+
+// Signed integer of 1, 2 or 5 bytes. The single byte form is biased by 0x40
+// and the two byte form by 0xC000.
+int32 Decompressor::readVarInt() {
+	byte head = readByte();
+
+	if (head == 0xFF) {
+		uint32 x = readByte() << 24;
+		x |= readByte() << 16;
+		x |= readByte() << 8;
+		return (int32)(x | readByte());
+	}
+
+	if (head >= 0x80)
+		return (int16)((((head - 0xC0) & 0xFF) << 8) | readByte());
+
+	return head - 0x40;
+}
+
+void Decompressor::write(const void *data, uint32 length) {
+	if (_error || length > (uint32)(_dstEnd - _dst)) {
+		_error = true;
+		return;
+	}
+
+	memcpy(_dst, data, length);
+	_dst += length;
+}
+
+void Decompressor::writeUint16BE(uint16 x) {
+	byte data[2] = { (byte)(x >> 8), (byte)x };
+	write(data, 2);
+}
+
+void Decompressor::writeUint32BE(uint32 x) {
+	byte data[4] = { (byte)(x >> 24), (byte)(x >> 16), (byte)(x >> 8), (byte)x };
+	write(data, 4);
+}
+
+void Decompressor::writeLiteral(uint32 length, bool store) {
+	if (length > (uint32)(_srcEnd - _src)) {
+		_error = true;
+		return;
+	}
+
+	if (store)
+		_literals.push_back(std::make_pair((uint32)(_dst - _dstStart), length));
+
+	write(_src, length);
+	_src += length;
+}
+
+void Decompressor::writeStoredLiteral(uint32 index) {
+	if (index >= _literals.size()) {
+		_error = true;
+		return;
+	}
+
+	// The stored literal is always fully behind the write position
+	write(_dstStart + _literals[index].first, _literals[index].second);
+}
+
+void Decompressor::writeRepeat(uint32 value, uint32 valueLength) {
+	int32 count = readVarInt() + 1;
+
+	if (count <= 0 || (uint32)count * valueLength > (uint32)(_dstEnd - _dst)) {
+		_error = true;
+		return;
+	}
+
+	if (valueLength == 1) {
+		memset(_dst, value, count);
+		_dst += count;
+	} else {
+		while (count--)
+			writeUint16BE(value);
+	}
+}
+
+// The 0xFE codes shared by 'dcmp' (0) and (1)
+bool Decompressor::doExtendedCode(byte code) {
+	switch (code) {
+	case 0x00: {
+		// Segment loader jump table entries, as in 'CODE' 0: each is an
+		// offset followed by "move.w #segment,-(sp); _LoadSeg"
+		uint16 segment = readVarInt();
+		byte entryTail[6] = { 0x3F, 0x3C, (byte)(segment >> 8), (byte)segment, 0xA9, 0xF0 };
+
+		// The first entry's offset was written by an earlier code
+		write(entryTail, sizeof(entryTail));
+
+		int32 count = readVarInt();
+		if (count <= 0)
+			return false;
+
+		uint16 offset = readVarInt();
+		writeUint16BE(offset);
+		write(entryTail, sizeof(entryTail));
+
+		// The rest are deltas from the previous offset, biased by 6
+		for (int32 i = 1; i < count && !_error; i++) {
+			offset += readVarInt() - 6;
+			writeUint16BE(offset);
+			write(entryTail, sizeof(entryTail));
+		}
+		break;
+	}
+	case 0x02:
+		writeRepeat(readVarInt(), 1);
+		break;
+	case 0x03:
+		writeRepeat(readVarInt(), 2);
+		break;
+	case 0x04: {
+		// Run of 16-bit values, each stored as a byte delta from the last
+		uint16 value = readVarInt();
+		int32 count = readVarInt();
+
+		writeUint16BE(value);
+		for (int32 i = 0; i < count && !_error; i++) {
+			value += (int8)readByte();
+			writeUint16BE(value);
+		}
+		break;
+	}
+	case 0x06: {
+		// Run of 32-bit values, each stored as a delta from the last
+		uint32 value = readVarInt();
+		int32 count = readVarInt();
+
+		writeUint32BE(value);
+		for (int32 i = 0; i < count && !_error; i++) {
+			value += readVarInt();
+			writeUint32BE(value);
+		}
+		break;
+	}
+	default:
+		return false;
+	}
+
+	return !_error;
+}
+
+bool Decompressor::decompress0() {
+	while (!_error) {
+		byte code = readByte();
+
+		if (code < 0x20) {
+			// Literal of an even number of bytes; 0x1X ones are remembered
+			uint32 count = code & 0x0F;
+			if (count == 0)
+				count = readByte();
+
+			writeLiteral(count * 2, code >= 0x10);
+		} else if (code < 0x23) {
+			// Reference to a stored literal past the one byte range
+			uint32 index = readByte();
+			if (code == 0x22)
+				index = (index << 8) | readByte();
+			else
+				index |= (code - 0x20) << 8;
+
+			writeStoredLiteral(index + 0x28);
+		} else if (code < 0x4B) {
+			writeStoredLiteral(code - 0x23);
+		} else if (code < 0xFE) {
+			writeUint16BE(s_dcmp0Table[code - 0x4B]);
+		} else if (code == 0xFE) {
+			if (!doExtendedCode(readByte()))
+				return false;
+		} else {
+			break; // 0xFF marks the end
+		}
+	}
+
+	return finish();
+}
+
+bool Decompressor::decompress1() {
+	while (!_error) {
+		byte code = readByte();
+
+		if (code < 0x20) {
+			// Short literal; 0x1X ones are remembered
+			writeLiteral((code & 0x0F) + 1, code >= 0x10);
+		} else if (code < 0xD0) {
+			writeStoredLiteral(code - 0x20);
+		} else if (code == 0xD0 || code == 0xD1) {
+			writeLiteral(readByte(), code == 0xD1);
+		} else if (code == 0xD2) {
+			writeStoredLiteral(readByte() + 0xB0);
+		} else if (code >= 0xD5 && code < 0xFE) {
+			writeUint16BE(s_dcmp1Table[code - 0xD5]);
+		} else if (code == 0xFE) {
+			// Only the byte repeat is used here
+			byte extendedCode = readByte();
+			if (extendedCode != 0x02 || !doExtendedCode(extendedCode))
+				return false;
+		} else if (code == 0xFF) {
+			break;
+		} else {
+			// 0xD3 and 0xD4 aren't assigned in any of the descriptions (there
+			// is no 16-bit stored literal index like 'dcmp' (0)'s 0x22), so
+			// they can only come from corrupt data
+			return false;
+		}
+	}
+
+	return finish();
+}
+
+bool Decompressor::decompress2(byte tableCount, byte flags) {
+	// Either a custom table of two-byte words follows the header, or the
+	// default one is used
+	uint16 table[256];
+
+	if (flags & 1) {
+		for (uint32 i = 0; i <= tableCount; i++) {
+			table[i] = readByte() << 8;
+			table[i] |= readByte();
+		}
+	} else {
+		if (tableCount != 0xFF && tableCount != 0)
+			return false;
+
+		memcpy(table, s_dcmp2DefaultTable, sizeof(table));
+		tableCount = 0xFF;
+	}
+
+	bool tagged = (flags & 2) != 0;
+	bool oddLength = ((_dstEnd - _dstStart) & 1) != 0;
+
+	while (_src != _srcEnd && !_error) {
+		// An odd output length puts the final byte as-is at the very end
+		if (oddLength && _srcEnd - _src == 1) {
+			write(_src++, 1);
+			break;
+		}
+
+		byte code = readByte();
+
+		if (!tagged) {
+			if (code > tableCount)
+				return false;
+
+			writeUint16BE(table[code]);
+			continue;
+		}
+
+		// Each tag byte covers the next eight words, high bit first: set bits
+		// are table references, clear ones are two literal bytes
+		for (int bit = 7; bit >= 0 && _src != _srcEnd && !_error; bit--) {
+			if (code & (1 << bit)) {
+				byte index = readByte();
+				if (index > tableCount)
+					return false;
+
+				writeUint16BE(table[index]);
+			} else if (oddLength && _srcEnd - _src == 1) {
+				write(_src++, 1);
+			} else {
+				writeLiteral(2, false);
+			}
+		}
+	}
+
+	return finish();
+}
+
+bool isCompressedResource(const byte *data, uint32 length) {
+	if (length < COMPRESSED_HEADER_SIZE || READ_UINT32_BE(data) != COMPRESSED_RESOURCE_TAG)
+		return false;
+
+	// Header length, then the header version (8 or 9) and the compressed flag
+	return READ_UINT16_BE(data + 4) == COMPRESSED_HEADER_SIZE && (data[6] == 8 || data[6] == 9) && (data[7] & 1) != 0;
+}
+
+uint32 getDecompressedSize(const byte *data) {
+	return READ_UINT32_BE(data + 8);
+}
+
+bool isPlausibleDecompressedSize(const byte *data, uint32 length) {
+	return getDecompressedSize(data) <= MAX_DECOMPRESSED_SIZE;
+}
+
+bool decompressResource(const byte *src, uint32 srcLength, byte *dst, uint32 dstLength) {
+	if (!isCompressedResource(src, srcLength) || getDecompressedSize(src) != dstLength)
+		return false;
+
+	// Version 8 headers keep the 'dcmp' id after two buffer sizing bytes,
+	// version 9 ones put it first and follow it with parameters
+	uint16 dcmpID = (src[6] == 8) ? READ_UINT16_BE(src + 14) : READ_UINT16_BE(src + 12);
+
+	Decompressor decompressor(src + COMPRESSED_HEADER_SIZE, srcLength - COMPRESSED_HEADER_SIZE, dst, dstLength);
+
+	switch (dcmpID) {
+	case 0:
+		return decompressor.decompress0();
+	case 1:
+		return decompressor.decompress1();
+	case 2:
+		return decompressor.decompress2(src[16], src[17]);
+	default:
+		break;
+	}
+
+	return false;
+}
@@ -0,0 +1,44 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef DCMP_H
+#define DCMP_H
+
+#include "types.h"
+
+// System 7 compressed resources ('dcmp' 0, 1 and 2)
+
+// Check for the extended resource header (0xA89F6572)
+bool isCompressedResource(const byte *data, uint32 length);
+
+// The size of the data once expanded, as given in the header
+uint32 getDecompressedSize(const byte *data);
+
+// Whether that size is believable, so a corrupt header can't ask for a
+// huge buffer before any data has been looked at
+bool isPlausibleDecompressedSize(const byte *data, uint32 length);
+
+// Expand a compressed resource into a buffer of getDecompressedSize() bytes.
+// Fails on corrupt data or an unknown 'dcmp'.
+bool decompressResource(const byte *src, uint32 srcLength, byte *dst, uint32 dstLength);
+
+#endif
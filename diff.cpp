@@ -0,0 +1,178 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <atomic>
+#include <map>
+#include <string.h>
+#include <thread>
+
+#include "diff.h"
+#include "macresfork.h"
+
+typedef std::pair<uint32, uint16> ResourceKey;
+
+static void addResources(ResourceFork &resFork, std::map<ResourceKey, std::string> &resources) {
+	std::vector<uint32> typeList = resFork.getTagArray();
+
+	for (uint32 i = 0; i < typeList.size(); i++) {
+		std::vector<uint16> idList = resFork.getIDArray(typeList[i]);
+
+		for (uint32 j = 0; j < idList.size(); j++)
+			resources[ResourceKey(typeList[i], idList[j])] = resFork.getFilename(typeList[i], idList[j]);
+	}
+}
+
+struct HashJob {
+	ResourceFork *oldFork;
+	ResourceFork *newFork;
+	std::vector<ResourceDifference> *differences;
+	std::vector<uint32> candidates; // Same-sized entries in differences
+	std::atomic<uint32> nextCandidate;
+};
+
+struct CompareState {
+	const byte *data;
+	uint32 length;
+	uint32 pos;
+};
+
+static bool compareChunk(const byte *data, uint32 length, void *context) {
+	CompareState *state = (CompareState *)context;
+
+	if (length > state->length - state->pos || memcmp(data, state->data + state->pos, length) != 0)
+		return false;
+
+	state->pos += length;
+	return true;
+}
+
+// Matching hashes are only very likely to mean matching data, so check
+// the bytes before calling a resource unchanged
+static bool compareResources(ResourceFork &oldFork, ResourceFork &newFork, uint32 tag, uint16 id) {
+	DataPair newData = newFork.getResource(tag, id);
+	if (!newData)
+		return false;
+
+	CompareState state;
+	state.data = newData.data;
+	state.length = newData.length;
+	state.pos = 0;
+
+	return oldFork.readResourceChunks(tag, id, compareChunk, &state) && state.pos == state.length;
+}
+
+static void compareHashes(HashJob *job) {
+	for (;;) {
+		uint32 i = job->nextCandidate++;
+		if (i >= job->candidates.size())
+			break;
+
+		ResourceDifference &difference = (*job->differences)[job->candidates[i]];
+		uint64 oldHash, newHash;
+
+		if (!job->oldFork->hashResource(difference.tag, difference.id, oldHash) ||
+				!job->newFork->hashResource(difference.tag, difference.id, newHash) || oldHash != newHash ||
+				!compareResources(*job->oldFork, *job->newFork, difference.tag, difference.id))
+			difference.flags |= kDiffChanged;
+	}
+}
+
+std::vector<ResourceDifference> diffResourceForks(ResourceFork &oldFork, ResourceFork &newFork, uint jobCount) {
+	std::map<ResourceKey, std::string> oldResources, newResources;
+	addResources(oldFork, oldResources);
+	addResources(newFork, newResources);
+
+	std::vector<ResourceDifference> differences;
+	HashJob job;
+
+	// Both maps are sorted, so walk them side by side
+	std::map<ResourceKey, std::string>::const_iterator oldIt = oldResources.begin();
+	std::map<ResourceKey, std::string>::const_iterator newIt = newResources.begin();
+
+	while (oldIt != oldResources.end() || newIt != newResources.end()) {
+		ResourceDifference difference;
+		difference.flags = 0;
+		difference.oldSize = difference.newSize = 0;
+
+		if (newIt == newResources.end() || (oldIt != oldResources.end() && oldIt->first < newIt->first)) {
+			difference.tag = oldIt->first.first;
+			difference.id = oldIt->first.second;
+			difference.flags = kDiffRemoved;
+			difference.oldName = oldIt->second;
+			difference.oldSize = oldFork.getResourceSize(difference.tag, difference.id);
+			oldIt++;
+		} else if (oldIt == oldResources.end() || newIt->first < oldIt->first) {
+			difference.tag = newIt->first.first;
+			difference.id = newIt->first.second;
+			difference.flags = kDiffAdded;
+			difference.newName = newIt->second;
+			difference.newSize = newFork.getResourceSize(difference.tag, difference.id);
+			newIt++;
+		} else {
+			difference.tag = oldIt->first.first;
+			difference.id = oldIt->first.second;
+			difference.oldName = oldIt->second;
+			difference.newName = newIt->second;
+			difference.oldSize = oldFork.getResourceSize(difference.tag, difference.id);
+			difference.newSize = newFork.getResourceSize(difference.tag, difference.id);
+
+			if (difference.oldName != difference.newName)
+				difference.flags |= kDiffRenamed;
+
+			if (difference.oldSize != difference.newSize)
+				difference.flags |= kDiffChanged;
+			else if (difference.oldSize != 0)
+				job.candidates.push_back(differences.size());
+
+			oldIt++;
+			newIt++;
+		}
+
+		differences.push_back(difference);
+	}
+
+	// Now hash whatever the sizes couldn't tell apart
+	job.oldFork = &oldFork;
+	job.newFork = &newFork;
+	job.differences = &differences;
+	job.nextCandidate = 0;
+
+	if (jobCount > job.candidates.size())
+		jobCount = job.candidates.size();
+
+	std::vector<std::thread> threads;
+	for (uint i = 1; i < jobCount; i++)
+		threads.push_back(std::thread(compareHashes, &job));
+
+	compareHashes(&job);
+
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	// Only report what actually differs
+	std::vector<ResourceDifference> result;
+	for (uint32 i = 0; i < differences.size(); i++)
+		if (differences[i].flags != 0)
+			result.push_back(differences[i]);
+
+	return result;
+}
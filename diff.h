@@ -0,0 +1,55 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+class ResourceFork;
+
+enum {
+	kDiffAdded = 1 << 0,
+	kDiffRemoved = 1 << 1,
+	kDiffChanged = 1 << 2,
+	kDiffRenamed = 1 << 3
+};
+
+struct ResourceDifference {
+	uint32 tag;
+	uint16 id;
+	uint32 flags;
+	std::string oldName;
+	std::string newName;
+	uint32 oldSize;
+	uint32 newSize;
+};
+
+// Match up resources by (tag, id) and report how oldFork became newFork.
+// Sizes are compared first; only same-sized payloads get hashed, in
+// parallel and straight from the input, and matching hashes are confirmed
+// byte for byte.
+std::vector<ResourceDifference> diffResourceForks(ResourceFork &oldFork, ResourceFork &newFork, uint jobCount);
+
+#endif
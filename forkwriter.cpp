@@ -0,0 +1,355 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <algorithm>
+#include <map>
+#include <string.h>
+
+#include "forkwriter.h"
+#include "macresfork.h"
+
+// Resource data offsets in the reference list are only 24 bits
+#define MAX_DATA_SIZE 0x1000000
+
+#define FORK_HEADER_SIZE 256
+#define MAP_HEADER_SIZE 28
+
+#define MBI_INFOHDR 128
+#define MAXNAMELEN 63
+
+#define APPLEDOUBLE_HEADER_SIZE 38
+
+#define COPY_BUFFER_SIZE (1024 * 1024)
+
+struct Payload {
+	uint64 sourceOffset; // Of the length field, as in ResourceForkID
+	uint32 length;       // Including the length field
+	uint32 newOffset;
+};
+
+static bool comparePayloadOffsets(const Payload &p1, const Payload &p2) {
+	return p1.sourceOffset < p2.sourceOffset;
+}
+
+ResourceForkWriter::ResourceForkWriter(ResourceFork &source) {
+	_source = &source;
+	_deduplicate = false;
+	_resourceCount = 0;
+	_duplicateCount = 0;
+}
+
+bool ResourceForkWriter::hashPayload(uint64 offset, uint32 length, uint64 &hash) {
+	byte buffer[64 * 1024];
+	hash = HASH_INITIAL_VALUE;
+
+	while (length > 0) {
+		uint32 chunkSize = (length < sizeof(buffer)) ? length : sizeof(buffer);
+
+		if (_source->readRawData(offset, buffer, chunkSize) != chunkSize)
+			return false;
+
+		hash = updateHash(hash, buffer, chunkSize);
+		offset += chunkSize;
+		length -= chunkSize;
+	}
+
+	return true;
+}
+
+bool ResourceForkWriter::comparePayloads(uint64 offset1, uint64 offset2, uint32 length) {
+	byte buffer1[32 * 1024], buffer2[32 * 1024];
+
+	while (length > 0) {
+		uint32 chunkSize = (length < sizeof(buffer1)) ? length : sizeof(buffer1);
+
+		if (_source->readRawData(offset1, buffer1, chunkSize) != chunkSize ||
+				_source->readRawData(offset2, buffer2, chunkSize) != chunkSize ||
+				memcmp(buffer1, buffer2, chunkSize))
+			return false;
+
+		offset1 += chunkSize;
+		offset2 += chunkSize;
+		length -= chunkSize;
+	}
+
+	return true;
+}
+
+// buffer holds COPY_BUFFER_SIZE bytes, and is shared by every run
+bool ResourceForkWriter::copyPayloads(uint64 offset, uint64 length, byte *buffer, FILE *output) {
+	while (length > 0) {
+		uint32 chunkSize = (length < COPY_BUFFER_SIZE) ? length : COPY_BUFFER_SIZE;
+
+		if (_source->readRawData(offset, buffer, chunkSize) != chunkSize || fwrite(buffer, 1, chunkSize, output) != chunkSize)
+			return false;
+
+		offset += chunkSize;
+		length -= chunkSize;
+	}
+
+	return true;
+}
+
+bool ResourceForkWriter::write(FILE *output, ForkContainer container, const std::string &macName) {
+	const std::vector<ResourceForkType> &sourceTypes = _source->getTypes();
+
+	// Gather the payloads that are going to survive. Ones shared by several
+	// references (from an earlier dedup, say) are only written once anyway.
+	std::vector<const ResourceForkType *> types;
+	std::map<uint64, uint32> payloadIndex;
+	std::vector<Payload> payloads;
+
+	_resourceCount = 0;
+	_duplicateCount = 0;
+
+	for (uint32 i = 0; i < sourceTypes.size(); i++) {
+		if (_strippedTypes.count(sourceTypes[i].tag))
+			continue;
+
+		types.push_back(&sourceTypes[i]);
+
+		for (uint32 j = 0; j < sourceTypes[i].ids.size(); j++) {
+			uint64 offset = sourceTypes[i].ids[j].offset;
+			_resourceCount++;
+
+			if (payloadIndex.count(offset))
+				continue;
+
+			byte lengthField[4];
+			if (_source->readRawData(offset, lengthField, 4) != 4)
+				return false;
+
+			// A corrupt length could otherwise wrap around, or send the copy
+			// past the end of the fork
+			uint64 length = (uint64)READ_UINT32_BE(lengthField) + 4;
+
+			if (offset + length > _source->getForkOffset() + _source->getForkSize()) {
+				fprintf(stderr, "Resource at offset %llu runs past the end of the fork\n", (unsigned long long)offset);
+				return false;
+			}
+
+			if (length > MAX_DATA_SIZE) {
+				fprintf(stderr, "Resource data does not fit in 16MB\n");
+				return false;
+			}
+
+			Payload payload;
+			payload.sourceOffset = offset;
+			payload.length = length;
+			payload.newOffset = 0;
+			payloadIndex[offset] = payloads.size();
+			payloads.push_back(payload);
+		}
+	}
+
+	// Write in source order, so reading the input stays sequential
+	std::sort(payloads.begin(), payloads.end(), comparePayloadOffsets);
+
+	for (uint32 i = 0; i < payloads.size(); i++)
+		payloadIndex[payloads[i].sourceOffset] = i;
+
+	// Point identical payloads at the first copy
+	std::vector<uint32> canonical(payloads.size());
+
+	for (uint32 i = 0; i < payloads.size(); i++)
+		canonical[i] = i;
+
+	if (_deduplicate) {
+		std::multimap<std::pair<uint32, uint64>, uint32> seen;
+
+		for (uint32 i = 0; i < payloads.size(); i++) {
+			uint64 hash;
+			if (!hashPayload(payloads[i].sourceOffset, payloads[i].length, hash))
+				return false;
+
+			std::pair<uint32, uint64> key(payloads[i].length, hash);
+			std::multimap<std::pair<uint32, uint64>, uint32>::const_iterator it = seen.lower_bound(key);
+
+			for (; it != seen.end() && it->first == key; it++) {
+				if (comparePayloads(payloads[it->second].sourceOffset, payloads[i].sourceOffset, payloads[i].length)) {
+					canonical[i] = it->second;
+					_duplicateCount++;
+					break;
+				}
+			}
+
+			if (canonical[i] == i)
+				seen.insert(std::make_pair(key, i));
+		}
+	}
+
+	// Lay out the data section
+	uint32 dataSize = 0;
+
+	for (uint32 i = 0; i < payloads.size(); i++) {
+		if (canonical[i] != i)
+			continue;
+
+		if ((uint64)dataSize + payloads[i].length > MAX_DATA_SIZE) {
+			fprintf(stderr, "Resource data does not fit in 16MB\n");
+			return false;
+		}
+
+		payloads[i].newOffset = dataSize;
+		dataSize += payloads[i].length;
+	}
+
+	for (uint32 i = 0; i < payloads.size(); i++)
+		payloads[i].newOffset = payloads[canonical[i]].newOffset;
+
+	// Build the map: header, type list, reference lists, then names
+	uint32 refCount = 0;
+	for (uint32 i = 0; i < types.size(); i++)
+		refCount += types[i]->ids.size();
+
+	uint32 typeListSize = 2 + types.size() * 8;
+	uint32 nameListOffset = MAP_HEADER_SIZE + typeListSize + refCount * 12;
+
+	// The name list offset and every reference list offset are 16-bit, and
+	// the name list comes after all of them
+	if (nameListOffset > 0xffff) {
+		fprintf(stderr, "Too many resources\n");
+		return false;
+	}
+
+	std::vector<byte> map(nameListOffset);
+	std::vector<byte> names;
+
+	WRITE_UINT16_BE(&map[24], MAP_HEADER_SIZE);
+	WRITE_UINT16_BE(&map[26], nameListOffset);
+	WRITE_UINT16_BE(&map[MAP_HEADER_SIZE], types.size() - 1);
+
+	uint32 refListOffset = typeListSize;
+	byte *ref = &map[MAP_HEADER_SIZE + typeListSize];
+
+	for (uint32 i = 0; i < types.size(); i++) {
+		byte *type = &map[MAP_HEADER_SIZE + 2 + i * 8];
+		WRITE_UINT32_BE(type, types[i]->tag);
+		WRITE_UINT16_BE(type + 4, types[i]->ids.size() - 1);
+		WRITE_UINT16_BE(type + 6, refListOffset);
+
+		for (uint32 j = 0; j < types[i]->ids.size(); j++) {
+			const ResourceForkID &id = types[i]->ids[j];
+			uint16 nameOffset = 0xffff;
+
+			if (!id.filename.empty()) {
+				if (names.size() >= 0xffff) {
+					fprintf(stderr, "Too many resource names\n");
+					return false;
+				}
+
+				nameOffset = names.size();
+				uint32 nameLength = (id.filename.size() < 255) ? id.filename.size() : 255;
+				names.push_back(nameLength);
+				names.insert(names.end(), id.filename.begin(), id.filename.begin() + nameLength);
+			}
+
+			WRITE_UINT16_BE(ref, id.id);
+			WRITE_UINT16_BE(ref + 2, nameOffset);
+			WRITE_UINT32_BE(ref + 4, (id.attributes << 24) | payloads[payloadIndex[id.offset]].newOffset);
+			ref += 12;
+		}
+
+		refListOffset += types[i]->ids.size() * 12;
+	}
+
+	map.insert(map.end(), names.begin(), names.end());
+
+	// The map starts with a copy of the fork header
+	byte forkHeader[FORK_HEADER_SIZE];
+	memset(forkHeader, 0, sizeof(forkHeader));
+	WRITE_UINT32_BE(forkHeader, FORK_HEADER_SIZE);
+	WRITE_UINT32_BE(forkHeader + 4, FORK_HEADER_SIZE + dataSize);
+	WRITE_UINT32_BE(forkHeader + 8, dataSize);
+	WRITE_UINT32_BE(forkHeader + 12, map.size());
+	memcpy(&map[0], forkHeader, 16);
+
+	uint32 forkSize = FORK_HEADER_SIZE + dataSize + map.size();
+
+	// Container header
+	if (container == kForkContainerMacBinary) {
+		byte infoHeader[MBI_INFOHDR];
+		memset(infoHeader, 0, sizeof(infoHeader));
+
+		uint32 nameLength = (macName.size() < MAXNAMELEN) ? macName.size() : MAXNAMELEN;
+		infoHeader[1] = nameLength;
+		memcpy(infoHeader + 2, macName.c_str(), nameLength);
+		WRITE_UINT32_BE(infoHeader + 87, forkSize);
+		infoHeader[122] = 129; // MacBinary II
+		infoHeader[123] = 129;
+		WRITE_UINT16_BE(infoHeader + 124, updateCRC16(0, infoHeader, 124));
+
+		if (fwrite(infoHeader, 1, sizeof(infoHeader), output) != sizeof(infoHeader))
+			return false;
+	} else if (container == kForkContainerAppleDouble) {
+		byte doubleHeader[APPLEDOUBLE_HEADER_SIZE];
+		memset(doubleHeader, 0, sizeof(doubleHeader));
+
+		WRITE_UINT32_BE(doubleHeader, 0x00051607);
+		WRITE_UINT32_BE(doubleHeader + 4, 0x00020000);
+		WRITE_UINT16_BE(doubleHeader + 24, 1);
+		WRITE_UINT32_BE(doubleHeader + 26, 2); // Resource fork entry
+		WRITE_UINT32_BE(doubleHeader + 30, APPLEDOUBLE_HEADER_SIZE);
+		WRITE_UINT32_BE(doubleHeader + 34, forkSize);
+
+		if (fwrite(doubleHeader, 1, sizeof(doubleHeader), output) != sizeof(doubleHeader))
+			return false;
+	}
+
+	if (fwrite(forkHeader, 1, sizeof(forkHeader), output) != sizeof(forkHeader))
+		return false;
+
+	// Copy the data section, merging payloads that were already adjacent
+	// into one long sequential copy
+	std::vector<byte> copyBuffer(COPY_BUFFER_SIZE);
+
+	for (uint32 i = 0; i < payloads.size();) {
+		if (canonical[i] != i) {
+			i++;
+			continue;
+		}
+
+		uint64 runOffset = payloads[i].sourceOffset;
+		uint64 runLength = payloads[i].length;
+
+		for (i++; i < payloads.size() && canonical[i] == i && payloads[i].sourceOffset == runOffset + runLength; i++)
+			runLength += payloads[i].length;
+
+		if (!copyPayloads(runOffset, runLength, &copyBuffer[0], output))
+			return false;
+	}
+
+	if (fwrite(&map[0], 1, map.size(), output) != map.size())
+		return false;
+
+	// MacBinary pads each fork out to 128 bytes
+	if (container == kForkContainerMacBinary && (forkSize & 127) != 0) {
+		byte padding[128];
+		memset(padding, 0, sizeof(padding));
+
+		uint32 paddingSize = 128 - (forkSize & 127);
+		if (fwrite(padding, 1, paddingSize, output) != paddingSize)
+			return false;
+	}
+
+	return true;
+}
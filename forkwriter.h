@@ -0,0 +1,68 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef FORKWRITER_H
+#define FORKWRITER_H
+
+#include <set>
+#include <stdio.h>
+#include <string>
+#include "types.h"
+
+class ResourceFork;
+
+enum ForkContainer {
+	kForkContainerRaw,
+	kForkContainerMacBinary,
+	kForkContainerAppleDouble
+};
+
+// Writes a fresh copy of a loaded resource fork: the data section is laid
+// out contiguously (dropping any dead space) and the type, reference and
+// name lists are regenerated. Payloads are copied as stored, so compressed
+// resources stay compressed.
+class ResourceForkWriter {
+public:
+	ResourceForkWriter(ResourceFork &source);
+
+	void stripType(uint32 tag) { _strippedTypes.insert(tag); }
+	void setDeduplicate(bool deduplicate) { _deduplicate = deduplicate; }
+
+	// macName is only used for the MacBinary header
+	bool write(FILE *output, ForkContainer container, const std::string &macName);
+
+	uint32 getResourceCount() const { return _resourceCount; }
+	uint32 getDuplicateCount() const { return _duplicateCount; }
+
+private:
+	bool hashPayload(uint64 offset, uint32 length, uint64 &hash);
+	bool comparePayloads(uint64 offset1, uint64 offset2, uint32 length);
+	bool copyPayloads(uint64 offset, uint64 length, byte *buffer, FILE *output);
+
+	ResourceFork *_source;
+	std::set<uint32> _strippedTypes;
+	bool _deduplicate;
+	uint32 _resourceCount;
+	uint32 _duplicateCount;
+};
+
+#endif
@@ -0,0 +1,246 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "grep.h"
+#include "macresfork.h"
+
+// More distinct first bytes than this and a table lookup wins
+#define MAX_VECTOR_FIRST_BYTES 4
+
+PatternScanner::PatternScanner(const std::vector<std::string> &patterns) {
+	_patterns = patterns;
+	_maxLength = 0;
+
+	for (uint32 i = 0; i < patterns.size(); i++) {
+		if (patterns[i].empty())
+			continue;
+
+		byte firstByte = patterns[i][0];
+
+		if (_patternsByFirstByte[firstByte].empty())
+			_firstBytes.push_back(firstByte);
+
+		_patternsByFirstByte[firstByte].push_back(i);
+
+		if (patterns[i].size() > _maxLength)
+			_maxLength = patterns[i].size();
+	}
+}
+
+const byte *PatternScanner::findCandidate(const byte *data, const byte *end) const {
+	if (_firstBytes.size() == 1)
+		return (const byte *)memchr(data, _firstBytes[0], end - data);
+
+#ifdef __SSE2__
+	if (_firstBytes.size() <= MAX_VECTOR_FIRST_BYTES) {
+		__m128i needles[MAX_VECTOR_FIRST_BYTES];
+		for (uint32 i = 0; i < _firstBytes.size(); i++)
+			needles[i] = _mm_set1_epi8((char)_firstBytes[i]);
+
+		for (; end - data >= 16; data += 16) {
+			__m128i block = _mm_loadu_si128((const __m128i *)data);
+			__m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+
+			for (uint32 i = 1; i < _firstBytes.size(); i++)
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+
+			int mask = _mm_movemask_epi8(hits);
+			if (mask != 0)
+				return data + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for (; data < end; data++)
+		if (!_patternsByFirstByte[*data].empty())
+			return data;
+
+	return 0;
+}
+
+void PatternScanner::scan(const byte *data, uint32 length, uint32 startLimit, uint32 minEnd, std::vector<Match> &matches) const {
+	if (_firstBytes.empty())
+		return;
+
+	const byte *end = data + length;
+	const byte *limit = data + ((startLimit < length) ? startLimit : length);
+	const byte *candidate = data;
+
+	while (candidate < limit && (candidate = findCandidate(candidate, limit)) != 0) {
+		const std::vector<uint32> &candidates = _patternsByFirstByte[*candidate];
+
+		for (uint32 i = 0; i < candidates.size(); i++) {
+			const std::string &pattern = _patterns[candidates[i]];
+			uint32 patternEnd = candidate - data + pattern.size();
+
+			if (candidate + pattern.size() <= end && patternEnd > minEnd && !memcmp(candidate, pattern.c_str(), pattern.size())) {
+				Match match;
+				match.offset = candidate - data;
+				match.patternIndex = candidates[i];
+				matches.push_back(match);
+			}
+		}
+
+		candidate++;
+	}
+}
+
+struct ResourceSearch {
+	const PatternScanner *scanner;
+	std::vector<byte> tail;    // Last getMaxLength() - 1 bytes seen
+	std::vector<byte> seam;    // tail plus the start of the next chunk
+	uint32 position;           // Resource offset of the current chunk
+	std::vector<PatternScanner::Match> matches;
+};
+
+static bool searchChunk(const byte *data, uint32 length, void *context) {
+	ResourceSearch *search = (ResourceSearch *)context;
+	uint32 overlap = search->scanner->getMaxLength() - 1;
+	uint32 tailSize = search->tail.size();
+	uint32 firstMatch = search->matches.size();
+
+	// Anything straddling the previous chunk and this one
+	if (tailSize != 0) {
+		uint32 headSize = (length < overlap) ? length : overlap;
+		search->seam.assign(search->tail.begin(), search->tail.end());
+		search->seam.insert(search->seam.end(), data, data + headSize);
+		search->scanner->scan(&search->seam[0], search->seam.size(), tailSize, tailSize, search->matches);
+
+		for (uint32 i = firstMatch; i < search->matches.size(); i++)
+			search->matches[i].offset += search->position - tailSize;
+
+		firstMatch = search->matches.size();
+	}
+
+	// Then the chunk itself, in place
+	search->scanner->scan(data, length, length, 0, search->matches);
+
+	for (uint32 i = firstMatch; i < search->matches.size(); i++)
+		search->matches[i].offset += search->position;
+
+	if (length >= overlap) {
+		search->tail.assign(data + length - overlap, data + length);
+	} else {
+		search->tail.insert(search->tail.end(), data, data + length);
+		if (search->tail.size() > overlap)
+			search->tail.erase(search->tail.begin(), search->tail.end() - overlap);
+	}
+
+	search->position += length;
+	return true;
+}
+
+struct GrepItem {
+	uint32 forkIndex;
+	uint32 tag;
+	uint16 id;
+};
+
+struct GrepJob {
+	const std::vector<ResourceFork *> *forks;
+	const PatternScanner *scanner;
+	std::vector<GrepItem> items;
+	std::vector<std::vector<GrepMatch> > results; // One list per item
+	std::atomic<uint32> nextItem;
+};
+
+static void processGrepItems(GrepJob *job) {
+	for (;;) {
+		uint32 i = job->nextItem++;
+		if (i >= job->items.size())
+			break;
+
+		const GrepItem &item = job->items[i];
+
+		ResourceSearch search;
+		search.scanner = job->scanner;
+		search.position = 0;
+
+		(*job->forks)[item.forkIndex]->readResourceChunks(item.tag, item.id, searchChunk, &search);
+
+		for (uint32 j = 0; j < search.matches.size(); j++) {
+			GrepMatch match;
+			match.forkIndex = item.forkIndex;
+			match.tag = item.tag;
+			match.id = item.id;
+			match.offset = search.matches[j].offset;
+			match.patternIndex = search.matches[j].patternIndex;
+			job->results[i].push_back(match);
+		}
+	}
+}
+
+std::vector<GrepMatch> grepResourceForks(const std::vector<ResourceFork *> &forks, const std::vector<std::string> &patterns, uint jobCount) {
+	PatternScanner scanner(patterns);
+
+	GrepJob job;
+	job.forks = &forks;
+	job.scanner = &scanner;
+	job.nextItem = 0;
+
+	if (scanner.getMaxLength() == 0)
+		return std::vector<GrepMatch>();
+
+	for (uint32 i = 0; i < forks.size(); i++) {
+		std::vector<uint32> typeList = forks[i]->getTagArray();
+
+		for (uint32 j = 0; j < typeList.size(); j++) {
+			std::vector<uint16> idList = forks[i]->getIDArray(typeList[j]);
+
+			for (uint32 k = 0; k < idList.size(); k++) {
+				GrepItem item;
+				item.forkIndex = i;
+				item.tag = typeList[j];
+				item.id = idList[k];
+				job.items.push_back(item);
+			}
+		}
+	}
+
+	job.results.resize(job.items.size());
+
+	if (jobCount > job.items.size())
+		jobCount = job.items.size();
+
+	std::vector<std::thread> threads;
+	for (uint i = 1; i < jobCount; i++)
+		threads.push_back(std::thread(processGrepItems, &job));
+
+	processGrepItems(&job);
+
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	std::vector<GrepMatch> matches;
+	for (uint32 i = 0; i < job.results.size(); i++)
+		matches.insert(matches.end(), job.results[i].begin(), job.results[i].end());
+
+	return matches;
+}
@@ -0,0 +1,70 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GREP_H
+#define GREP_H
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+class ResourceFork;
+
+// Finds every occurrence of a set of byte strings. Candidate positions are
+// found by looking for the patterns' first bytes (16 at a time with SSE2
+// when there are only a few distinct ones) and then checked in full.
+class PatternScanner {
+public:
+	PatternScanner(const std::vector<std::string> &patterns);
+
+	struct Match {
+		uint32 offset;
+		uint32 patternIndex;
+	};
+
+	// Report matches starting before startLimit and ending after minEnd
+	void scan(const byte *data, uint32 length, uint32 startLimit, uint32 minEnd, std::vector<Match> &matches) const;
+
+	uint32 getMaxLength() const { return _maxLength; }
+
+private:
+	const byte *findCandidate(const byte *data, const byte *end) const;
+
+	std::vector<std::string> _patterns;
+	std::vector<uint32> _patternsByFirstByte[256];
+	std::vector<byte> _firstBytes;
+	uint32 _maxLength;
+};
+
+struct GrepMatch {
+	uint32 forkIndex;
+	uint32 tag;
+	uint16 id;
+	uint32 offset; // Into the (decompressed) resource data
+	uint32 patternIndex;
+};
+
+// Search every resource in every fork, spread over jobCount threads. Results
+// come back in fork, then map, order.
+std::vector<GrepMatch> grepResourceForks(const std::vector<ResourceFork *> &forks, const std::vector<std::string> &patterns, uint jobCount);
+
+#endif
@@ -0,0 +1,463 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+// Based on Apple's Technical Note TN1150 and Inside Macintosh: Files
+
+#include <string.h>
+
+#include "hfs.h"
+#include "macroman.h"
+#include "util.h"
+
+#define HFS_SIGNATURE        0x4244 // 'BD'
+#define HFSPLUS_SIGNATURE    0x482B // 'H+'
+#define HFSX_SIGNATURE       0x4858 // 'HX'
+#define HFS_ROOT_FOLDER_ID   2
+#define HFS_CATALOG_FILE_ID  4
+#define HFS_RSRC_FORK        0xFF
+
+static uint64 readUint64BE(const byte *data) {
+	return ((uint64)READ_UINT32_BE(data) << 32) | READ_UINT32_BE(data + 4);
+}
+
+static std::string convertUTF16ToUTF8(const byte *data, uint32 length) {
+	std::string result;
+
+	for (uint32 i = 0; i < length; i++) {
+		uint32 c = READ_UINT16_BE(data + i * 2);
+
+		// Surrogate pair
+		if (c >= 0xD800 && c < 0xDC00 && i + 1 < length) {
+			uint32 low = READ_UINT16_BE(data + (i + 1) * 2);
+
+			if (low >= 0xDC00 && low < 0xE000) {
+				c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+				i++;
+			}
+		}
+
+		if (c < 0x80) {
+			result += (char)c;
+		} else if (c < 0x800) {
+			result += (char)(0xC0 | (c >> 6));
+			result += (char)(0x80 | (c & 0x3F));
+		} else if (c < 0x10000) {
+			result += (char)(0xE0 | (c >> 12));
+			result += (char)(0x80 | ((c >> 6) & 0x3F));
+			result += (char)(0x80 | (c & 0x3F));
+		} else {
+			result += (char)(0xF0 | (c >> 18));
+			result += (char)(0x80 | ((c >> 12) & 0x3F));
+			result += (char)(0x80 | ((c >> 6) & 0x3F));
+			result += (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	return result;
+}
+
+HFSVolume::HFSVolume() {
+	_file = 0;
+	_isHFSPlus = false;
+	_allocStart = 0;
+	_blockSize = 0;
+}
+
+HFSVolume::~HFSVolume() {
+	close();
+}
+
+bool HFSVolume::open(const char *filename) {
+	_file = fopen(filename, "rb");
+
+	if (!_file)
+		return false;
+
+	if (!findVolume(0, 0)) {
+		close();
+		return false;
+	}
+
+	// Now that the whole catalog has been walked, resolve the paths and
+	// the complete extent list of every resource fork
+	for (uint32 i = 0; i < _catalogFiles.size(); i++) {
+		CatalogFile &catalogFile = _catalogFiles[i];
+		addOverflowExtents(catalogFile.file.fileID, HFS_RSRC_FORK, catalogFile.rsrcSize, catalogFile.rsrcExtents);
+
+		HFSFile file = catalogFile.file;
+		file.path = getFolderPath(catalogFile.parentID) + sanitizeName(catalogFile.name);
+		file.rsrcExtents = toByteExtents(catalogFile.rsrcExtents, catalogFile.rsrcSize);
+		_files.push_back(file);
+	}
+
+	_overflowExtents.clear();
+	_folders.clear();
+	_catalogFiles.clear();
+	return true;
+}
+
+void HFSVolume::close() {
+	if (_file) {
+		fclose(_file);
+		_file = 0;
+	}
+
+	_overflowExtents.clear();
+	_folders.clear();
+	_catalogFiles.clear();
+	_files.clear();
+}
+
+bool HFSVolume::findVolume(uint64 offset, int depth) {
+	// Don't go chasing nested wrappers forever
+	if (depth > 2)
+		return false;
+
+	byte header[512];
+	seekFile(_file, offset + 1024);
+	if (fread(header, 1, sizeof(header), _file) == sizeof(header)) {
+		uint16 signature = READ_UINT16_BE(header);
+
+		if (signature == HFS_SIGNATURE) {
+			// HFS+ volumes are usually wrapped in an HFS volume so older
+			// systems can show a "you need a newer OS" file.
+			if (READ_UINT16_BE(header + 124) == HFSPLUS_SIGNATURE) {
+				uint64 allocStart = offset + READ_UINT16_BE(header + 28) * 512;
+				uint64 embedStart = allocStart + (uint64)READ_UINT16_BE(header + 126) * READ_UINT32_BE(header + 20);
+				return findVolume(embedStart, depth + 1);
+			}
+
+			return openHFS(offset, header);
+		}
+
+		if (signature == HFSPLUS_SIGNATURE || signature == HFSX_SIGNATURE)
+			return openHFSPlus(offset, header);
+	}
+
+	if (depth != 0)
+		return false;
+
+	seekFile(_file, offset);
+	if (fread(header, 1, sizeof(header), _file) != sizeof(header))
+		return false;
+
+	// DiskCopy 4.2 images have an 84 byte header in front of the disk
+	if (READ_UINT16_BE(header + 82) == 0x0100 && header[0] < 64)
+		return findVolume(offset + 84, depth + 1);
+
+	// Apple Partition Map: look for the first HFS partition
+	if (READ_UINT16_BE(header) == 0x4552) { // 'ER'
+		uint32 blockSize = READ_UINT16_BE(header + 2);
+		if (blockSize == 0)
+			blockSize = 512;
+
+		uint32 mapBlockCount = 1;
+		for (uint32 i = 1; i <= mapBlockCount; i++) {
+			seekFile(_file, offset + (uint64)i * blockSize);
+			if (fread(header, 1, sizeof(header), _file) != sizeof(header) || READ_UINT16_BE(header) != 0x504D) // 'PM'
+				break;
+
+			mapBlockCount = READ_UINT32_BE(header + 4);
+
+			if (!strncmp((const char *)header + 48, "Apple_HFS", 32))
+				return findVolume(offset + (uint64)READ_UINT32_BE(header + 8) * blockSize, depth + 1);
+		}
+	}
+
+	return false;
+}
+
+bool HFSVolume::openHFS(uint64 offset, const byte *mdb) {
+	_isHFSPlus = false;
+	_blockSize = READ_UINT32_BE(mdb + 20);
+	_allocStart = offset + READ_UINT16_BE(mdb + 28) * 512;
+
+	if (_blockSize == 0 || (_blockSize % 512) != 0)
+		return false;
+
+	BlockExtentList extentsFile, catalogFile;
+	readHFSExtents(mdb + 134, extentsFile);
+	readHFSExtents(mdb + 150, catalogFile);
+
+	if (!walkBTree(kBTreeExtents, extentsFile, READ_UINT32_BE(mdb + 130)))
+		return false;
+
+	uint64 catalogSize = READ_UINT32_BE(mdb + 146);
+	addOverflowExtents(HFS_CATALOG_FILE_ID, 0, catalogSize, catalogFile);
+	return walkBTree(kBTreeCatalog, catalogFile, catalogSize);
+}
+
+bool HFSVolume::openHFSPlus(uint64 offset, const byte *header) {
+	_isHFSPlus = true;
+	_blockSize = READ_UINT32_BE(header + 40);
+	_allocStart = offset;
+
+	if (_blockSize == 0 || (_blockSize % 512) != 0)
+		return false;
+
+	// Fork data for the special files
+	const byte *extentsFork = header + 192;
+	const byte *catalogFork = header + 272;
+
+	BlockExtentList extentsFile, catalogFile;
+	readHFSPlusExtents(extentsFork + 16, extentsFile);
+	readHFSPlusExtents(catalogFork + 16, catalogFile);
+
+	if (!walkBTree(kBTreeExtents, extentsFile, readUint64BE(extentsFork)))
+		return false;
+
+	uint64 catalogSize = readUint64BE(catalogFork);
+	addOverflowExtents(HFS_CATALOG_FILE_ID, 0, catalogSize, catalogFile);
+	return walkBTree(kBTreeCatalog, catalogFile, catalogSize);
+}
+
+bool HFSVolume::walkBTree(BTreeKind kind, const BlockExtentList &extents, uint64 size) {
+	// An empty extents overflow file is fine
+	if (size == 0)
+		return kind == kBTreeExtents;
+
+	ExtentReadStream stream(_file, toByteExtents(extents, size));
+
+	// The header record directly follows the 14 byte node descriptor of node 0
+	byte header[512];
+	if (stream.read(header, sizeof(header)) != sizeof(header))
+		return false;
+
+	uint32 firstLeafNode = READ_UINT32_BE(header + 14 + 10);
+	uint16 nodeSize = READ_UINT16_BE(header + 14 + 18);
+	uint32 totalNodes = READ_UINT32_BE(header + 14 + 22);
+
+	if (nodeSize < 512 || (nodeSize & (nodeSize - 1)) != 0)
+		return false;
+
+	if (totalNodes > size / nodeSize)
+		return false;
+
+	std::vector<byte> node(nodeSize);
+	std::vector<bool> visited(totalNodes);
+	uint32 nodeIndex = firstLeafNode;
+
+	// Follow the leaf chain, bailing out if it loops rather than reading
+	// the same records twice
+	while (nodeIndex != 0) {
+		if (nodeIndex >= totalNodes || visited[nodeIndex])
+			return false;
+
+		visited[nodeIndex] = true;
+
+		if (!stream.seek((uint64)nodeIndex * nodeSize) || stream.read(&node[0], nodeSize) != nodeSize)
+			return false;
+
+		if (node[8] != 0xFF) // Leaf node
+			return false;
+
+		// The offset table grows down from the end of the node and can't
+		// run into the descriptor
+		uint16 recordCount = READ_UINT16_BE(&node[10]);
+		if (14 + 2 * ((uint32)recordCount + 1) > nodeSize)
+			return false;
+
+		uint32 tableStart = nodeSize - 2 * (recordCount + 1);
+
+		for (uint16 i = 0; i < recordCount; i++) {
+			uint16 recordStart = READ_UINT16_BE(&node[nodeSize - 2 * (i + 1)]);
+			uint16 recordEnd = READ_UINT16_BE(&node[nodeSize - 2 * (i + 2)]);
+
+			if (recordStart < 14 || recordEnd <= recordStart || recordEnd > tableStart)
+				continue;
+
+			if (kind == kBTreeExtents)
+				parseExtentRecord(&node[recordStart], recordEnd - recordStart);
+			else
+				parseCatalogRecord(&node[recordStart], recordEnd - recordStart);
+		}
+
+		nodeIndex = READ_UINT32_BE(&node[0]);
+	}
+
+	return true;
+}
+
+void HFSVolume::parseExtentRecord(const byte *record, uint32 length) {
+	BlockExtentList extents;
+	uint32 fileID;
+	byte forkType;
+
+	if (_isHFSPlus) {
+		uint32 dataOffset = 2 + READ_UINT16_BE(record);
+		if (length < 12 || dataOffset + 64 > length)
+			return;
+
+		forkType = record[2];
+		fileID = READ_UINT32_BE(record + 4);
+		readHFSPlusExtents(record + dataOffset, extents);
+	} else {
+		uint32 dataOffset = (record[0] + 2) & ~1;
+		if (length < 8 || dataOffset + 12 > length)
+			return;
+
+		forkType = record[1];
+		fileID = READ_UINT32_BE(record + 2);
+		readHFSExtents(record + dataOffset, extents);
+	}
+
+	BlockExtentList &list = _overflowExtents[ForkKey(fileID, forkType)];
+	list.insert(list.end(), extents.begin(), extents.end());
+}
+
+void HFSVolume::parseCatalogRecord(const byte *record, uint32 length) {
+	uint32 parentID;
+	std::string name;
+	const byte *data;
+	uint32 dataLength;
+
+	if (_isHFSPlus) {
+		uint32 keyLength = READ_UINT16_BE(record);
+		if (keyLength < 6 || 2 + keyLength + 2 > length)
+			return;
+
+		uint32 nameLength = READ_UINT16_BE(record + 6);
+		if (8 + nameLength * 2 > 2 + keyLength)
+			return;
+
+		parentID = READ_UINT32_BE(record + 2);
+		name = convertUTF16ToUTF8(record + 8, nameLength);
+		data = record + 2 + keyLength;
+		dataLength = length - 2 - keyLength;
+
+		uint16 recordType = READ_UINT16_BE(data);
+
+		if (recordType == 1 && dataLength >= 12) {
+			Folder &folder = _folders[READ_UINT32_BE(data + 8)];
+			folder.parentID = parentID;
+			folder.name = name;
+		} else if (recordType == 2 && dataLength >= 248) {
+			const byte *rsrcFork = data + 168;
+
+			CatalogFile catalogFile;
+			catalogFile.parentID = parentID;
+			catalogFile.name = name;
+			catalogFile.file.fileID = READ_UINT32_BE(data + 8);
+			catalogFile.file.type = READ_UINT32_BE(data + 48);
+			catalogFile.file.creator = READ_UINT32_BE(data + 52);
+			catalogFile.rsrcSize = readUint64BE(rsrcFork);
+			readHFSPlusExtents(rsrcFork + 16, catalogFile.rsrcExtents);
+
+			if (catalogFile.rsrcSize != 0)
+				_catalogFiles.push_back(catalogFile);
+		}
+	} else {
+		uint32 keyLength = record[0];
+		if (keyLength < 6 || 1 + keyLength >= length)
+			return;
+
+		uint32 nameLength = record[6];
+		if (7 + nameLength > 1 + keyLength)
+			return;
+
+		parentID = READ_UINT32_BE(record + 2);
+		name = convertMacRomanToUTF8(std::string((const char *)record + 7, nameLength));
+		data = record + ((keyLength + 2) & ~1);
+		dataLength = length - ((keyLength + 2) & ~1);
+
+		if (dataLength == 0)
+			return;
+
+		if (data[0] == 1 && dataLength >= 10) {
+			Folder &folder = _folders[READ_UINT32_BE(data + 6)];
+			folder.parentID = parentID;
+			folder.name = name;
+		} else if (data[0] == 2 && dataLength >= 102) {
+			CatalogFile catalogFile;
+			catalogFile.parentID = parentID;
+			catalogFile.name = name;
+			catalogFile.file.fileID = READ_UINT32_BE(data + 20);
+			catalogFile.file.type = READ_UINT32_BE(data + 4);
+			catalogFile.file.creator = READ_UINT32_BE(data + 8);
+			catalogFile.rsrcSize = READ_UINT32_BE(data + 36);
+			readHFSExtents(data + 86, catalogFile.rsrcExtents);
+
+			if (catalogFile.rsrcSize != 0)
+				_catalogFiles.push_back(catalogFile);
+		}
+	}
+}
+
+void HFSVolume::readHFSExtents(const byte *data, BlockExtentList &extents) const {
+	for (int i = 0; i < 3; i++)
+		if (READ_UINT16_BE(data + i * 4 + 2) != 0)
+			extents.push_back(BlockExtent(READ_UINT16_BE(data + i * 4), READ_UINT16_BE(data + i * 4 + 2)));
+}
+
+void HFSVolume::readHFSPlusExtents(const byte *data, BlockExtentList &extents) const {
+	for (int i = 0; i < 8; i++)
+		if (READ_UINT32_BE(data + i * 8 + 4) != 0)
+			extents.push_back(BlockExtent(READ_UINT32_BE(data + i * 8), READ_UINT32_BE(data + i * 8 + 4)));
+}
+
+void HFSVolume::addOverflowExtents(uint32 fileID, byte forkType, uint64 size, BlockExtentList &extents) const {
+	uint64 totalSize = 0;
+	for (uint32 i = 0; i < extents.size(); i++)
+		totalSize += (uint64)extents[i].count * _blockSize;
+
+	if (totalSize >= size)
+		return;
+
+	std::map<ForkKey, BlockExtentList>::const_iterator it = _overflowExtents.find(ForkKey(fileID, forkType));
+	if (it != _overflowExtents.end())
+		extents.insert(extents.end(), it->second.begin(), it->second.end());
+}
+
+std::vector<Extent> HFSVolume::toByteExtents(const BlockExtentList &extents, uint64 size) const {
+	std::vector<Extent> byteExtents;
+
+	for (uint32 i = 0; i < extents.size() && size > 0; i++) {
+		uint64 length = (uint64)extents[i].count * _blockSize;
+		if (length > size)
+			length = size;
+
+		byteExtents.push_back(Extent(_allocStart + (uint64)extents[i].start * _blockSize, length));
+		size -= length;
+	}
+
+	return byteExtents;
+}
+
+std::string HFSVolume::getFolderPath(uint32 folderID) const {
+	std::string path;
+
+	// Walk up to the root, with a sanity limit in case of a loop
+	for (int depth = 0; folderID != HFS_ROOT_FOLDER_ID && depth < 256; depth++) {
+		std::map<uint32, Folder>::const_iterator it = _folders.find(folderID);
+		if (it == _folders.end())
+			break;
+
+		path = sanitizeName(it->second.name) + "/" + path;
+		folderID = it->second.parentID;
+	}
+
+	return path;
+}
+
+SeekableReadStream *HFSVolume::createResourceForkStream(FILE *file, const HFSFile &hfsFile) const {
+	return new ExtentReadStream(file, hfsFile.rsrcExtents);
+}
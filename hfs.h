@@ -0,0 +1,112 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef HFS_H
+#define HFS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "stream.h"
+
+// A file on an HFS/HFS+ volume that has a resource fork
+struct HFSFile {
+	HFSFile() { fileID = type = creator = 0; }
+
+	std::string path; // '/'-separated, relative to the volume root
+	uint32 fileID;
+	uint32 type;
+	uint32 creator;
+	std::vector<Extent> rsrcExtents; // Byte ranges within the image
+};
+
+// Reads the catalog of an HFS or HFS+ disk image (raw, DiskCopy 4.2, or
+// Apple partitioned) directly, without having to mount it.
+class HFSVolume {
+public:
+	HFSVolume();
+	~HFSVolume();
+
+	bool open(const char *filename);
+	void close();
+
+	const std::vector<HFSFile> &getFiles() const { return _files; }
+
+	// Create a stream for a file's resource fork, reading through the given
+	// handle so that multiple threads can each use their own.
+	SeekableReadStream *createResourceForkStream(FILE *file, const HFSFile &hfsFile) const;
+
+private:
+	// A run of allocation blocks
+	struct BlockExtent {
+		BlockExtent() { start = count = 0; }
+		BlockExtent(uint32 s, uint32 c) { start = s; count = c; }
+
+		uint32 start;
+		uint32 count;
+	};
+
+	typedef std::vector<BlockExtent> BlockExtentList;
+	typedef std::pair<uint32, byte> ForkKey; // (file ID, fork type)
+
+	struct Folder {
+		uint32 parentID;
+		std::string name;
+	};
+
+	struct CatalogFile {
+		uint32 parentID;
+		std::string name;
+		HFSFile file;
+		uint64 rsrcSize;
+		BlockExtentList rsrcExtents;
+	};
+
+	enum BTreeKind {
+		kBTreeExtents,
+		kBTreeCatalog
+	};
+
+	bool findVolume(uint64 offset, int depth);
+	bool openHFS(uint64 offset, const byte *mdb);
+	bool openHFSPlus(uint64 offset, const byte *header);
+	bool walkBTree(BTreeKind kind, const BlockExtentList &extents, uint64 size);
+	void parseExtentRecord(const byte *record, uint32 length);
+	void parseCatalogRecord(const byte *record, uint32 length);
+	void readHFSExtents(const byte *data, BlockExtentList &extents) const;
+	void readHFSPlusExtents(const byte *data, BlockExtentList &extents) const;
+	void addOverflowExtents(uint32 fileID, byte forkType, uint64 size, BlockExtentList &extents) const;
+	std::vector<Extent> toByteExtents(const BlockExtentList &extents, uint64 size) const;
+	std::string getFolderPath(uint32 folderID) const;
+
+	FILE *_file;
+	bool _isHFSPlus;
+	uint64 _allocStart; // Byte offset of allocation block 0
+	uint32 _blockSize;
+
+	std::map<ForkKey, BlockExtentList> _overflowExtents;
+	std::map<uint32, Folder> _folders;
+	std::vector<CatalogFile> _catalogFiles;
+	std::vector<HFSFile> _files;
+};
+
+#endif
@@ -24,10 +24,14 @@
 
 #include <stdio.h>
 
+#include "binhex.h"
+#include "dcmp.h"
 #include "macresfork.h"
 
 ResourceFork::ResourceFork() {
-	_file = 0;
+	_stream = 0;
+	_forkOffset = 0;
+	_forkSize = 0;
 }
 
 ResourceFork::~ResourceFork() {
@@ -41,6 +45,9 @@ bool ResourceFork::load(const char *filename) {
 	if (loadFromAppleDouble(filename))
 		return true;
 
+	if (loadFromBinHex(filename))
+		return true;
+
 	if (loadFromRawFork(filename))
 		return true;
 	
@@ -50,10 +57,30 @@ bool ResourceFork::load(const char *filename) {
 	return false;
 }
 
-bool ResourceFork::loadFromRawFork(std::string filename) {
-	_file = fopen(filename.c_str(), "rb");
+bool ResourceFork::load(SeekableReadStream *stream) {
+	_stream = stream;
+	return loadInternal();
+}
+
+bool ResourceFork::loadAtOffset(const char *filename, uint64 offset) {
+	if (!openFile(filename))
+		return false;
+
+	return loadInternal(offset);
+}
+
+bool ResourceFork::openFile(const std::string &filename) {
+	FILE *file = fopen(filename.c_str(), "rb");
+
+	if (!file)
+		return false;
+
+	_stream = new FileReadStream(file);
+	return true;
+}
 
-	if (!_file)
+bool ResourceFork::loadFromRawFork(std::string filename) {
+	if (!openFile(filename))
 		return false;
 
 	return loadInternal();
@@ -78,13 +105,14 @@ bool ResourceFork::loadFromMacBaseFilename(std::string filename) {
 #define MAXNAMELEN 63
 
 bool ResourceFork::loadFromMacBinary(std::string filename) {
-	_file = fopen(filename.c_str(), "rb");
-
-	if (!_file)
+	if (!openFile(filename))
 		return false;
 
 	byte infoHeader[MBI_INFOHDR];
-	fread(infoHeader, 1, MBI_INFOHDR, _file);
+	if (_stream->read(infoHeader, MBI_INFOHDR) != MBI_INFOHDR) {
+		close();
+		return false;
+	}
 
 	// Try to parse the MacBinary header
 	if (infoHeader[MBI_ZERO1] == 0 && infoHeader[MBI_ZERO2] == 0 &&
@@ -94,11 +122,11 @@ bool ResourceFork::loadFromMacBinary(std::string filename) {
 		uint32 dataSize = READ_UINT32_BE(infoHeader + MBI_DFLEN);
 		uint32 rsrcSize = READ_UINT32_BE(infoHeader + MBI_RFLEN);
 
-		uint32 dataSizePad = (((dataSize + 127) >> 7) << 7);
-		uint32 rsrcSizePad = (((rsrcSize + 127) >> 7) << 7);
+		uint64 dataSizePad = ((((uint64)dataSize + 127) >> 7) << 7);
+		uint64 rsrcSizePad = ((((uint64)rsrcSize + 127) >> 7) << 7);
 
 		// Length check
-		if (MBI_INFOHDR + dataSizePad + rsrcSizePad == getFileSize(_file))
+		if (MBI_INFOHDR + dataSizePad + rsrcSizePad == _stream->size())
 			return loadInternal(MBI_INFOHDR + dataSizePad);
 	}
 
@@ -107,25 +135,23 @@ bool ResourceFork::loadFromMacBinary(std::string filename) {
 }
 
 bool ResourceFork::loadFromAppleDouble(std::string filename) {
-	_file = fopen(filename.c_str(), "rb");
-
-	if (!_file)
+	if (!openFile(filename))
 		return false;
 
-	uint32 tag = readUint32BE(_file);
+	uint32 tag = _stream->readUint32BE();
 	if (tag != 0x00051607 && tag != 0x00051600) { // AppleDouble and AppleSingle, respectively
 		close();
 		return false;
 	}
 
-	fseek(_file, 20, SEEK_CUR); // version + home file system
+	_stream->seek(_stream->pos() + 20); // version + home file system
 
-	uint16 entryCount = readUint16BE(_file);
+	uint16 entryCount = _stream->readUint16BE();
 
 	for (uint16 i = 0; i < entryCount; i++) {
-		uint32 id = readUint32BE(_file);
-		uint32 offset = readUint32BE(_file);
-		/* uint32 length = */ readUint32BE(_file);
+		uint32 id = _stream->readUint32BE();
+		uint32 offset = _stream->readUint32BE();
+		/* uint32 length = */ _stream->readUint32BE();
 
 		if (id == 2) // Found the resource fork!
 			return loadInternal(offset);
@@ -135,65 +161,111 @@ bool ResourceFork::loadFromAppleDouble(std::string filename) {
 	return false;
 }
 
-bool ResourceFork::loadInternal(uint32 startOffset) {
-	fseek(_file, startOffset, SEEK_SET);
+bool ResourceFork::loadFromBinHex(std::string filename) {
+	FILE *file = fopen(filename.c_str(), "rb");
 
-	uint32 fileSize = getFileSize(_file);
-	uint32 dataOffset = readUint32BE(_file) + startOffset;
-	uint32 mapOffset = readUint32BE(_file) + startOffset;
-	uint32 dataSize = readUint32BE(_file);
-	uint32 mapSize = readUint32BE(_file);
+	if (!file)
+		return false;
+
+	_stream = decodeBinHexResourceFork(file);
+	fclose(file);
+
+	if (!_stream)
+		return false;
+
+	return loadInternal();
+}
 
-	if (feof(_file) || dataOffset == 0 || mapOffset == 0 || dataOffset >= fileSize || mapOffset >= fileSize
-			|| dataOffset + dataSize > fileSize || mapOffset + mapSize > fileSize) {
+bool ResourceFork::isValidHeader(const byte *header, uint64 startOffset, uint64 fileSize) {
+	uint64 dataOffset = READ_UINT32_BE(header);
+	uint64 mapOffset = READ_UINT32_BE(header + 4);
+	uint64 dataSize = READ_UINT32_BE(header + 8);
+	uint64 mapSize = READ_UINT32_BE(header + 12);
+
+	// The header itself is 16 bytes, so neither section can start before that.
+	// The map header is 28 bytes plus at least the type count.
+	if (dataOffset < 16 || mapOffset < 16 || mapSize < 30)
+		return false;
+
+	if (startOffset + dataOffset + dataSize > fileSize || startOffset + mapOffset + mapSize > fileSize)
+		return false;
+
+	return true;
+}
+
+bool ResourceFork::loadInternal(uint64 startOffset) {
+	_stream->seek(startOffset);
+
+	uint64 fileSize = _stream->size();
+
+	byte header[16];
+	if (_stream->read(header, 16) != 16 || !isValidHeader(header, startOffset, fileSize)) {
 		close();
 		return false;
 	}
 
-	fseek(_file, mapOffset + 24, SEEK_SET);
+	uint64 dataOffset = READ_UINT32_BE(header) + startOffset;
+	uint64 mapOffset = READ_UINT32_BE(header + 4) + startOffset;
+	uint32 dataSize = READ_UINT32_BE(header + 8);
+	uint32 mapSize = READ_UINT32_BE(header + 12);
+
+	_stream->seek(mapOffset + 24);
 
-	uint16 typeOffset = readUint16BE(_file);
-	uint16 nameOffset = readUint16BE(_file);
-	uint16 typeCount = readUint16BE(_file) + 1;
+	uint16 typeOffset = _stream->readUint16BE();
+	uint16 nameOffset = _stream->readUint16BE();
+	uint16 typeCount = _stream->readUint16BE() + 1;
 
-	if (feof(_file) || typeOffset == 0 || typeOffset >= fileSize) {
+	if (_stream->eos() || typeOffset == 0 || typeOffset >= mapSize || (uint32)(typeOffset + 2 + typeCount * 8) > mapSize) {
 		close();
 		return false;
 	}
 
+	_forkOffset = startOffset;
+	_forkSize = mapOffset + mapSize - startOffset;
+	if (dataOffset + dataSize > mapOffset + mapSize)
+		_forkSize = dataOffset + dataSize - startOffset;
+
 	_types.resize(typeCount);
 
 	for (uint16 i = 0; i < typeCount; i++) {
-		_types[i].tag = readUint32BE(_file);
-		uint16 idCount = readUint16BE(_file) + 1;
-		uint16 idOffset = readUint16BE(_file);
+		_types[i].tag = _stream->readUint32BE();
+		uint16 idCount = _stream->readUint16BE() + 1;
+		uint16 idOffset = _stream->readUint16BE();
+
+		uint64 lastTypePos = _stream->pos();
 
-		uint32 lastTypePos = ftell(_file);
+		if ((uint32)(typeOffset + idOffset + idCount * 12) > mapSize) {
+			close();
+			return false;
+		}
 
-		fseek(_file, idOffset + mapOffset + typeOffset, SEEK_SET);
+		_stream->seek(idOffset + mapOffset + typeOffset);
 
 		for (uint16 j = 0; j < idCount; j++) {
 			ResourceForkID id;
 
-			id.id = readUint16BE(_file);
-			uint16 idNameOffset = readUint16BE(_file);
-			id.offset = (readUint32BE(_file) & 0xffffff) + dataOffset;
-			readUint32BE(_file);
+			id.id = _stream->readUint16BE();
+			uint16 idNameOffset = _stream->readUint16BE();
+			uint32 attributesAndOffset = _stream->readUint32BE();
+			id.attributes = attributesAndOffset >> 24;
+			id.offset = (attributesAndOffset & 0xffffff) + dataOffset;
+			_stream->readUint32BE();
 
-			if (nameOffset != 0xffff) {
-				uint32 lastIDPos = ftell(_file);
+			if (idNameOffset != 0xffff) {
+				uint64 lastIDPos = _stream->pos();
 
-				fseek(_file, nameOffset + mapOffset + idNameOffset, SEEK_SET);
+				_stream->seek(nameOffset + mapOffset + idNameOffset);
 
-				byte stringLength = readByte(_file);
+				byte stringLength = _stream->readByte();
 				char *subFilename = new char[stringLength + 1];
 				subFilename[stringLength] = 0;
-				fread(subFilename, 1, stringLength, _file);
+				_stream->read(subFilename, stringLength);
 	
 				id.filename = subFilename;
+				delete[] subFilename;
 
 				if (j != idCount - 1)
-					fseek(_file, lastIDPos, SEEK_SET);
+					_stream->seek(lastIDPos);
 			}
 				 
 
@@ -201,80 +273,212 @@ bool ResourceFork::loadInternal(uint32 startOffset) {
 		}
 
 		if (i != typeCount - 1)
-			fseek(_file, lastTypePos, SEEK_SET);
+			_stream->seek(lastTypePos);
 	}
 
 	return true;
 }
 
 void ResourceFork::close() {
-	if (_file) {
-		fclose(_file);
-		_file = 0;
-	}
+	delete _stream;
+	_stream = 0;
 
 	_types.clear();
+	_forkOffset = 0;
+	_forkSize = 0;
 }
 
 bool ResourceFork::isOpen() const { 
-	return _file != 0;
+	return _stream != 0;
 }
 
-DataPair *ResourceFork::getResource(uint32 tag, uint16 id) {
-	for (uint32 i = 0; i < _types.size(); i++) {
-		if (_types[i].tag != tag)
-			continue;
+DataPair ResourceFork::getResource(uint32 tag, uint16 id) {
+	const ResourceForkID *resID = findResource(tag, id);
+
+	if (!resID)
+		return DataPair();
+
+	return readResource(resID->offset);
+}
 
+DataPair ResourceFork::getResource(const std::string &filename) {
+	for (uint32 i = 0; i < _types.size(); i++) {
 		for (uint32 j = 0; j < _types[i].ids.size(); j++) {
-			if (_types[i].ids[j].id != id)
+			if (compareStringIgnoreCase(_types[i].ids[j].filename.c_str(), filename.c_str()))
 				continue;
 
-			fseek(_file, _types[i].ids[j].offset, SEEK_SET);
-			uint32 length = readUint32BE(_file);
-			byte *data = new byte[length];
-			fread(data, 1, length, _file);
-			return new DataPair(data, length);
+			return readResource(_types[i].ids[j].offset);
 		}
 	}
 
-	return 0;
+	return DataPair();
 }
 
-DataPair *ResourceFork::getResource(const std::string &filename) {
+DataPair ResourceFork::getResource(uint32 tag, const std::string &filename) {
 	for (uint32 i = 0; i < _types.size(); i++) {
+		if (_types[i].tag != tag)
+			continue;
+
 		for (uint32 j = 0; j < _types[i].ids.size(); j++) {
 			if (compareStringIgnoreCase(_types[i].ids[j].filename.c_str(), filename.c_str()))
 				continue;
 
-			fseek(_file, _types[i].ids[j].offset, SEEK_SET);
-			uint32 length = readUint32BE(_file);
-			byte *data = new byte[length];
-			fread(data, 1, length, _file);
-			return new DataPair(data, length);
+			return readResource(_types[i].ids[j].offset);
 		}
 	}
 
-	return 0;
+	return DataPair();
+}
+
+uint32 ResourceFork::getResourceSize(uint32 tag, uint16 id) {
+	const ResourceForkID *resID = findResource(tag, id);
+
+	if (!resID)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stream->seek(resID->offset);
+	uint32 length = _stream->readUint32BE();
+
+	// Compressed resources report their expanded size
+	byte header[18];
+	if (length >= sizeof(header) && _stream->read(header, sizeof(header)) == sizeof(header) && isCompressedResource(header, sizeof(header)))
+		return getDecompressedSize(header);
+
+	return length;
+}
+
+bool ResourceFork::readResourceChunks(uint32 tag, uint16 id, ResourceChunkProc proc, void *context) {
+	const ResourceForkID *resID = findResource(tag, id);
+	return resID && readChunks(resID, false, proc, context);
+}
+
+bool ResourceFork::readChunks(const ResourceForkID *resID, bool keepStored, ResourceChunkProc proc, void *context) {
+	byte buffer[64 * 1024];
+	uint32 length, chunkSize;
+	uint64 pos;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stream->seek(resID->offset);
+		length = _stream->readUint32BE();
+		chunkSize = (length < sizeof(buffer)) ? length : sizeof(buffer);
+		chunkSize = _stream->read(buffer, chunkSize);
+		pos = _stream->pos();
+	}
+
+	// Compressed data has to be expanded as a whole
+	if (isCompressedResource(buffer, chunkSize)) {
+		DataPair pair = readResource(resID->offset);
+
+		if (pair || !keepStored)
+			return pair && proc(pair.data, pair.length, context);
+
+		// Better the stored bytes than nothing at all
+		fprintf(stderr, "Keeping resource at offset %llu as stored\n", (unsigned long long)resID->offset);
+	}
+
+	// Otherwise stream it through the buffer
+	uint32 bytesLeft = length;
+
+	while (chunkSize != 0) {
+		if (!proc(buffer, chunkSize, context))
+			return false;
+
+		bytesLeft -= chunkSize;
+		chunkSize = (bytesLeft < sizeof(buffer)) ? bytesLeft : sizeof(buffer);
+
+		if (chunkSize != 0) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stream->seek(pos);
+			chunkSize = _stream->read(buffer, chunkSize);
+			pos += chunkSize;
+		}
+	}
+
+	return bytesLeft == 0;
+}
+
+static bool writeChunk(const byte *data, uint32 length, void *context) {
+	return fwrite(data, 1, length, (FILE *)context) == length;
+}
+
+bool ResourceFork::writeResource(uint32 tag, uint16 id, FILE *output) {
+	return readResourceChunks(tag, id, writeChunk, output);
+}
+
+bool ResourceFork::dumpResource(uint32 tag, uint16 id, FILE *output) {
+	const ResourceForkID *resID = findResource(tag, id);
+	return resID && readChunks(resID, true, writeChunk, output);
+}
+
+static bool hashChunk(const byte *data, uint32 length, void *context) {
+	uint64 *hash = (uint64 *)context;
+	*hash = updateHash(*hash, data, length);
+	return true;
+}
+
+bool ResourceFork::hashResource(uint32 tag, uint16 id, uint64 &hash) {
+	hash = HASH_INITIAL_VALUE;
+	return readResourceChunks(tag, id, hashChunk, &hash);
+}
+
+uint32 ResourceFork::readRawData(uint64 offset, byte *buffer, uint32 length) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stream->seek(offset);
+	return _stream->read(buffer, length);
 }
 
-DataPair *ResourceFork::getResource(uint32 tag, const std::string &filename) {
+const ResourceForkID *ResourceFork::findResource(uint32 tag, uint16 id) const {
 	for (uint32 i = 0; i < _types.size(); i++) {
 		if (_types[i].tag != tag)
 			continue;
 
-		for (uint32 j = 0; j < _types[i].ids.size(); j++) {
-			if (compareStringIgnoreCase(_types[i].ids[j].filename.c_str(), filename.c_str()))
-				continue;
+		for (uint32 j = 0; j < _types[i].ids.size(); j++)
+			if (_types[i].ids[j].id == id)
+				return &_types[i].ids[j];
+	}
 
-			fseek(_file, _types[i].ids[j].offset, SEEK_SET);
-			uint32 length = readUint32BE(_file);
-			byte *data = new byte[length];
-			fread(data, 1, length, _file);
-			return new DataPair(data, length);
+	return 0;
+}
+
+DataPair ResourceFork::readResource(uint64 offset) {
+	DataPair pair;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stream->seek(offset);
+		uint32 length = _stream->readUint32BE();
+
+		// The length can't be trusted any further than the end of the fork
+		if (_stream->eos() || length > _stream->size() - _stream->pos()) {
+			fprintf(stderr, "Resource at offset %llu runs past the end of the fork\n", (unsigned long long)offset);
+			return DataPair();
+		}
+
+		pair = DataPair(length);
+		if (_stream->read(pair.data, pair.length) != pair.length) {
+			fprintf(stderr, "Failed to read resource at offset %llu\n", (unsigned long long)offset);
+			return DataPair();
 		}
 	}
 
-	return 0;
+	// Hand back System 7 compressed resources already expanded
+	if (isCompressedResource(pair.data, pair.length)) {
+		if (isPlausibleDecompressedSize(pair.data, pair.length)) {
+			DataPair decompressed(getDecompressedSize(pair.data));
+
+			if (decompressResource(pair.data, pair.length, decompressed.data, decompressed.length))
+				return decompressed;
+		}
+
+		// The raw bytes would be no use to anyone, and every other way of
+		// reading the resource has to agree with getResourceSize()
+		fprintf(stderr, "Failed to decompress resource at offset %llu\n", (unsigned long long)offset);
+		return DataPair();
+	}
+
+	return pair;
 }
 
 std::string ResourceFork::getFilename(uint32 tag, uint16 id) {
@@ -294,13 +498,13 @@ std::string ResourceFork::getFilename(uint32 tag, uint16 id) {
 	return "";
 }
 
-const char *ResourceFork::createOutputFilename(bool useInternalName, uint32 tag, uint16 id) {
+std::string ResourceFork::createOutputFilename(bool useInternalName, uint32 tag, uint16 id) {
 	std::string actualName = getFilename(tag, id);
 
 	if (useInternalName && !actualName.empty())
-		return actualName.c_str();
+		return actualName;
 
-	static char filename[14];
+	char filename[14];
 	sprintf(filename, "%c%c%c%c_%04x.dat", tag >> 24, (tag >> 16) & 0xff, (tag >> 8) & 0xff, tag & 0xff, id);
 
 	return filename;
@@ -23,16 +23,21 @@
 #ifndef MACRESFORK_H
 #define MACRESFORK_H
 
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
+#include "bufferpool.h"
+#include "stream.h"
 #include "util.h"
 
 struct ResourceForkID {
-	ResourceForkID() { id = 0; }
+	ResourceForkID() { id = 0; attributes = 0; }
 
 	uint16 id;
+	byte attributes;
 	std::string filename;
-	uint32 offset;
+	uint64 offset; // Of the payload's length field
 };
 
 struct ResourceForkType {
@@ -43,12 +48,44 @@ struct ResourceForkType {
 	std::vector<ResourceForkID> ids;
 };
 
-struct DataPair {
-	DataPair(byte *d, uint32 l) { data = d; length = l; }
-	~DataPair() { delete[] data; }
+// Gets handed a resource piece by piece; returning false stops the read
+typedef bool (*ResourceChunkProc)(const byte *data, uint32 length, void *context);
+
+// A resource's data, in a buffer borrowed from the calling thread's
+// BufferPool and handed back when this goes away. Move-only, since two
+// owners would release the buffer twice.
+class DataPair {
+public:
+	DataPair() { data = 0; length = 0; _capacity = 0; }
+	DataPair(uint32 l) { data = BufferPool::acquire(l, _capacity); length = l; }
+	DataPair(DataPair &&other) { data = 0; _capacity = 0; *this = std::move(other); }
+	~DataPair() { BufferPool::release(data, _capacity); }
+
+	DataPair(const DataPair &) = delete;
+	DataPair &operator=(const DataPair &) = delete;
+
+	DataPair &operator=(DataPair &&other) {
+		if (this != &other) {
+			BufferPool::release(data, _capacity);
+			data = other.data;
+			length = other.length;
+			_capacity = other._capacity;
+			other.data = 0;
+			other.length = 0;
+			other._capacity = 0;
+		}
+
+		return *this;
+	}
+
+	// False for resources that weren't found
+	explicit operator bool() const { return data != 0; }
 
 	byte *data;
 	uint32 length;
+
+private:
+	uint32 _capacity;
 };
 
 class ResourceFork {
@@ -57,28 +94,59 @@ public:
 	~ResourceFork();
 
 	bool load(const char *filename);
+	bool load(SeekableReadStream *stream); // Takes ownership of the stream
+	bool loadAtOffset(const char *filename, uint64 offset);
 	void close();
 	bool isOpen() const;
 
-	DataPair *getResource(uint32 tag, uint16 id);
-	DataPair *getResource(const std::string &filename);
-	DataPair *getResource(uint32 tag, const std::string &filename);
+	// Compressed resources come back expanded; ones that fail to expand
+	// can't be read at all, here or through the functions below (except
+	// dumpResource())
+	DataPair getResource(uint32 tag, uint16 id);
+	DataPair getResource(const std::string &filename);
+	DataPair getResource(uint32 tag, const std::string &filename);
+
+	// Look at or copy out a resource without holding all of it in memory
+	uint32 getResourceSize(uint32 tag, uint16 id);
+	bool readResourceChunks(uint32 tag, uint16 id, ResourceChunkProc proc, void *context);
+	bool writeResource(uint32 tag, uint16 id, FILE *output);
+	bool dumpResource(uint32 tag, uint16 id, FILE *output); // Writes what's stored if it can't be expanded
+	bool hashResource(uint32 tag, uint16 id, uint64 &hash);
 
 	std::string getFilename(uint32 tag, uint16 id);
-	const char *createOutputFilename(bool useInternalName, uint32 tag, uint16 id);
+	std::string createOutputFilename(bool useInternalName, uint32 tag, uint16 id);
 
 	std::vector<uint32> getTagArray();
 	std::vector<uint16> getIDArray(uint32 tag);
 
+	// Direct access to the map and the stored (possibly compressed) bytes, for rewriting forks
+	const std::vector<ResourceForkType> &getTypes() const { return _types; }
+	uint32 readRawData(uint64 offset, byte *buffer, uint32 length);
+
+	uint32 getTypeCount() const { return _types.size(); }
+	uint64 getForkOffset() const { return _forkOffset; } // In the stream; resource offsets include it
+	uint64 getForkSize() const { return _forkSize; }
+
+	// Check the 16 byte fork header found at startOffset in a file of fileSize bytes
+	static bool isValidHeader(const byte *header, uint64 startOffset, uint64 fileSize);
+
 private:
+	bool openFile(const std::string &filename);
 	bool loadFromRawFork(std::string filename);
 	bool loadFromMacBaseFilename(std::string filename);
 	bool loadFromMacBinary(std::string filename);
 	bool loadFromAppleDouble(std::string filename);
+	bool loadFromBinHex(std::string filename);
 
-	bool loadInternal(uint32 startOffset = 0);
+	bool loadInternal(uint64 startOffset = 0);
+	const ResourceForkID *findResource(uint32 tag, uint16 id) const;
+	DataPair readResource(uint64 offset);
+	bool readChunks(const ResourceForkID *resID, bool keepStored, ResourceChunkProc proc, void *context);
 
-	FILE *_file;
+	SeekableReadStream *_stream;
+	std::mutex _mutex; // Guards the stream, so resources can be read from multiple threads
+	uint64 _forkOffset;
+	uint64 _forkSize;
 	std::vector<ResourceForkType> _types;
 };
 
@@ -20,17 +20,42 @@
  *
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <ctype.h>
+#include <errno.h>
 #include <map>
+#include <mutex>
+#include <set>
+#include <stdlib.h>
 #include <string.h>
+#include <thread>
 
+#include "catalog.h"
+#include "diff.h"
+#include "forkwriter.h"
+#include "grep.h"
+#include "hfs.h"
 #include "macresfork.h"
+#include "macroman.h"
+#include "output.h"
+#include "resourcechain.h"
+#include "scan.h"
+#include "watch.h"
 
 enum RunMode {
 	kRunModeUnk,
 	kRunModeList,
 	kRunModeDump,
-	kRunModeConvert
+	kRunModeConvert,
+	kRunModeScan,
+	kRunModeDiff,
+	kRunModeRepack,
+	kRunModeGrep,
+	kRunModeIndex,
+	kRunModeQuery,
+	kRunModeWatch
 };
 
 RunMode parseMode(const char *modeDesc) {
@@ -40,36 +65,224 @@ RunMode parseMode(const char *modeDesc) {
 		return kRunModeDump;
 	else if (!strcmp(modeDesc, "convert"))
 		return kRunModeConvert;
+	else if (!strcmp(modeDesc, "scan"))
+		return kRunModeScan;
+	else if (!strcmp(modeDesc, "diff"))
+		return kRunModeDiff;
+	else if (!strcmp(modeDesc, "repack"))
+		return kRunModeRepack;
+	else if (!strcmp(modeDesc, "grep"))
+		return kRunModeGrep;
+	else if (!strcmp(modeDesc, "index"))
+		return kRunModeIndex;
+	else if (!strcmp(modeDesc, "query"))
+		return kRunModeQuery;
+	else if (!strcmp(modeDesc, "watch"))
+		return kRunModeWatch;
 
 	fprintf(stderr, "Unknown mode '%s'\n", modeDesc);
 	return kRunModeUnk;
 }
 
+// --alias XXXX=YYYY converts type XXXX as if it were YYYY
+typedef std::map<uint32, uint32> TagAliasMap;
+
+struct PatternOption {
+	PatternOption(bool h, const char *d) { isHex = h; desc = d; }
+
+	bool isHex;
+	const char *desc;
+};
+
 struct OptionSet {
 	RunMode mode;
 	const char *inputName;
+	const char *baseInputName;
 
 	bool useFileNames;
+	bool extract;
+	bool jsonl;
+	bool showStats;
+	uint jobCount;
+	const char *outputDirName;
+	uint32 shardFlags;
+	ForkContainer container;
+	std::vector<uint32> strippedTypes;
+	bool deduplicate;
+	bool sync;
+	std::vector<PatternOption> patterns;
+	bool macRoman;
+	std::vector<const char *> inputNames;
+	TagAliasMap aliases;
+	const char *catalogName;
+	bool hasQueryTag;
+	uint32 queryTag;
+	bool hasQueryID;
+	uint16 queryID;
+	const char *queryName;
+	RunMode watchMode;
+	uint32 settleTime;
+	std::vector<const char *> chainNames;
 };
 
+uint32 parseShardFlags(const char *shardDesc) {
+	if (!strcmp(shardDesc, "type"))
+		return kShardByType;
+	else if (!strcmp(shardDesc, "id"))
+		return kShardByID;
+	else if (!strcmp(shardDesc, "type,id"))
+		return kShardByType | kShardByID;
+
+	fprintf(stderr, "Unknown shard layout '%s'\n", shardDesc);
+	return kShardNone;
+}
+
+ForkContainer parseContainer(const char *containerDesc) {
+	if (!strcmp(containerDesc, "macbinary"))
+		return kForkContainerMacBinary;
+	else if (!strcmp(containerDesc, "appledouble"))
+		return kForkContainerAppleDouble;
+	else if (strcmp(containerDesc, "raw"))
+		fprintf(stderr, "Unknown format '%s'\n", containerDesc);
+
+	return kForkContainerRaw;
+}
+
+// Short type codes like 'STR' are padded out with spaces
+uint32 parseTag(const char *tagDesc) {
+	uint32 tag = 0;
+
+	for (uint32 i = 0; i < 4; i++)
+		tag = (tag << 8) | (*tagDesc ? (byte)*tagDesc++ : ' ');
+
+	return tag;
+}
+
+void parseAlias(const char *aliasDesc, TagAliasMap &aliases) {
+	const char *separator = strchr(aliasDesc, '=');
+
+	if (!separator || separator == aliasDesc || separator - aliasDesc > 4 || strlen(separator + 1) > 4 || !separator[1]) {
+		fprintf(stderr, "Bad alias '%s'; expected XXXX=YYYY\n", aliasDesc);
+		return;
+	}
+
+	std::string from(aliasDesc, separator - aliasDesc);
+	aliases[parseTag(from.c_str())] = parseTag(separator + 1);
+}
+
+// Whole decimal numbers only; anything else or out of range is rejected
+bool parseNumber(const char *numberDesc, uint32 minimum, uint32 &value) {
+	char *end;
+	errno = 0;
+	long long number = strtoll(numberDesc, &end, 10);
+
+	if (end == numberDesc || *end || errno == ERANGE || number < minimum || number > 0xFFFFFFFFLL)
+		return false;
+
+	value = (uint32)number;
+	return true;
+}
+
 OptionSet parseOptions(int argc, const char **argv) {
 	OptionSet options;
 	options.mode = parseMode(argv[1]);
 	options.inputName = argv[argc - 1];
+	options.baseInputName = 0;
 	options.useFileNames = false;
+	options.extract = false;
+	options.jsonl = false;
+	options.showStats = false;
+	options.jobCount = std::thread::hardware_concurrency();
+	options.outputDirName = ".";
+	options.shardFlags = kShardNone;
+	options.container = kForkContainerRaw;
+	options.deduplicate = false;
+	options.sync = false;
+	options.macRoman = false;
+	options.catalogName = "macresview.cat";
+	options.hasQueryTag = false;
+	options.queryTag = 0;
+	options.hasQueryID = false;
+	options.queryID = 0;
+	options.queryName = 0;
+	options.watchMode = kRunModeList;
+	options.settleTime = 200;
+
+	if (options.jobCount == 0)
+		options.jobCount = 1;
+
+	// Diffing takes the older file name first, and grep takes any number
+	// of file names after its options
+	int optionEnd = argc - 1;
+	if (options.mode == kRunModeDiff && optionEnd > 2)
+		options.baseInputName = argv[--optionEnd];
+	else if (options.mode == kRunModeGrep)
+		optionEnd = argc;
+
+	// Options sit between the mode and the file name(s)
+	for (int i = 2; i < optionEnd; i++) {
+		if (!strcmp(argv[i], "--use-file-names"))
+			options.useFileNames = true;
+		else if (!strcmp(argv[i], "--extract"))
+			options.extract = true;
+		else if (!strcmp(argv[i], "--jsonl"))
+			options.jsonl = true;
+		else if (!strcmp(argv[i], "--stats"))
+			options.showStats = true;
+		else if (!strcmp(argv[i], "--dedup"))
+			options.deduplicate = true;
+		else if (!strcmp(argv[i], "--sync"))
+			options.sync = true;
+		else if (!strcmp(argv[i], "--jobs") && i + 1 < optionEnd) {
+			uint32 jobCount;
+			if (!parseNumber(argv[++i], 1, jobCount)) {
+				fprintf(stderr, "Bad job count '%s'; expected a number of at least 1\n", argv[i]);
+				options.mode = kRunModeUnk;
+				return options;
+			}
 
-	if (argc > 3) {
-		int optionCount = argc - 3;
-		const char **optionStrings = argv + 2;
-
-		while (optionCount--) {
-			if (!strcmp(*optionStrings, "--use-file-names"))
-				options.useFileNames = true;
-			else
-				fprintf(stderr, "Unknown option '%s'", *optionStrings);
-
-			optionStrings++;
-		}
+			options.jobCount = jobCount;
+		} else if (!strcmp(argv[i], "--output-dir") && i + 1 < optionEnd)
+			options.outputDirName = argv[++i];
+		else if (!strcmp(argv[i], "--shard") && i + 1 < optionEnd)
+			options.shardFlags = parseShardFlags(argv[++i]);
+		else if (!strcmp(argv[i], "--format") && i + 1 < optionEnd)
+			options.container = parseContainer(argv[++i]);
+		else if (!strcmp(argv[i], "--strip") && i + 1 < optionEnd)
+			options.strippedTypes.push_back(parseTag(argv[++i]));
+		else if (!strcmp(argv[i], "--macroman"))
+			options.macRoman = true;
+		else if (!strcmp(argv[i], "--alias") && i + 1 < optionEnd)
+			parseAlias(argv[++i], options.aliases);
+		else if (!strcmp(argv[i], "--catalog") && i + 1 < optionEnd)
+			options.catalogName = argv[++i];
+		else if (!strcmp(argv[i], "--type") && i + 1 < optionEnd) {
+			options.hasQueryTag = true;
+			options.queryTag = parseTag(argv[++i]);
+		} else if (!strcmp(argv[i], "--id") && i + 1 < optionEnd) {
+			options.hasQueryID = true;
+			options.queryID = (uint16)strtol(argv[++i], 0, 0);
+		} else if (!strcmp(argv[i], "--name") && i + 1 < optionEnd)
+			options.queryName = argv[++i];
+		else if (!strcmp(argv[i], "--chain") && i + 1 < optionEnd)
+			options.chainNames.push_back(argv[++i]);
+		else if (!strcmp(argv[i], "--then") && i + 1 < optionEnd)
+			options.watchMode = parseMode(argv[++i]);
+		else if (!strcmp(argv[i], "--settle") && i + 1 < optionEnd) {
+			// Up to an hour, which is plenty and keeps poll()'s timeout in range
+			if (!parseNumber(argv[++i], 0, options.settleTime) || options.settleTime > 60 * 60 * 1000) {
+				fprintf(stderr, "Bad settle time '%s'; expected a number of milliseconds, up to an hour\n", argv[i]);
+				options.mode = kRunModeUnk;
+				return options;
+			}
+		} else if (!strcmp(argv[i], "--hex") && i + 1 < optionEnd)
+			options.patterns.push_back(PatternOption(true, argv[++i]));
+		else if (!strcmp(argv[i], "--string") && i + 1 < optionEnd)
+			options.patterns.push_back(PatternOption(false, argv[++i]));
+		else if (options.mode == kRunModeGrep && strncmp(argv[i], "--", 2))
+			options.inputNames.push_back(argv[i]);
+		else
+			fprintf(stderr, "Unknown option '%s'\n", argv[i]);
 	}
 
 	return options;
@@ -85,50 +298,51 @@ std::string addExtension(std::string fileName, const std::string &extension) {
 	return fileName;
 }
 
-bool outputDataPair(DataPair *pair, const std::string &fileName) {
-	if (!pair || fileName.empty())
+bool outputPICT(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options) {
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, fileName)) {
+		fprintf(stderr, "Could not open '%s' for writing\n", fileName.c_str());
 		return false;
+	}
 
-	FILE *output = fopen(fileName.c_str(), "wb");
+	FILE *output = outputFile.getFile();
 
-	if (!output)
-		return false;
+	// Output the 512 byte zero header
+	// (The only difference between resource fork PICTs and normal file PICTs)
+	for (int i = 0; i < 512; i++)
+		writeByte(output, 0);
 
-	fwrite(pair->data, 1, pair->length, output);
-	fflush(output);
-	fclose(output);
-	return true;
+	return resFork.writeResource(tag, id, output) && outputFile.commit();
 }
 
-bool outputPICT(DataPair *pair, std::string fileName) {
-	if (!pair || fileName.empty())
+// Unlike converting, dumping never loses a resource: one that can't be
+// expanded is written as stored
+bool dumpResource(ResourceFork &resFork, uint32 tag, uint16 id, OutputDirectory &outputDir, const std::string &fileName) {
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, fileName)) {
+		fprintf(stderr, "Could not open '%s' for writing\n", fileName.c_str());
 		return false;
+	}
 
-	fileName = addExtension(fileName, ".pict");
-
-	FILE *output = fopen(fileName.c_str(), "wb");
+	return resFork.dumpResource(tag, id, outputFile.getFile()) && outputFile.commit();
+}
 
-	if (!output) {
+// For types that are already a file format of their own
+bool outputRawResource(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options) {
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, fileName)) {
 		fprintf(stderr, "Could not open '%s' for writing\n", fileName.c_str());
 		return false;
 	}
 
-	// Output the 512 byte zero header
-	// (The only difference between resource fork PICTs and normal file PICTs)
-	for (int i = 0; i < 512; i++)
-		writeByte(output, 0);
-
-	fwrite(pair->data, 1, pair->length, output);
-	fflush(output);
-	fclose(output);
-	return true;
+	return resFork.writeResource(tag, id, outputFile.getFile()) && outputFile.commit();
 }
 
-bool outputMacSnd(DataPair *data, std::string fileName) {
+bool outputMacSnd(const DataPair &data, OutputDirectory &outputDir, const std::string &fileName) {
 	if (!data || fileName.empty())
 		return false;
 
-	uint16 sndType = READ_UINT16_BE(data->data);
+	uint16 sndType = READ_UINT16_BE(data.data);
 
 	if (sndType != 1 && sndType != 2) {
 		fprintf(stderr, "Unknown snd format type = %d\n", sndType);
@@ -138,38 +352,37 @@ bool outputMacSnd(DataPair *data, std::string fileName) {
 	uint32 soundHeaderOffset = 0;
 
 	if (sndType == 1) {
-		soundHeaderOffset = READ_UINT32_BE(data->data + 16);
+		soundHeaderOffset = READ_UINT32_BE(data.data + 16);
 	} else {
-		if (READ_UINT16_BE(data->data + 2) != 0)
+		if (READ_UINT16_BE(data.data + 2) != 0)
 			return false;
 
-		if (READ_UINT16_BE(data->data + 4) != 1)
+		if (READ_UINT16_BE(data.data + 4) != 1)
 			return false;
 
-		if (READ_UINT16_BE(data->data + 6) != 0x8050 && READ_UINT16_BE(data->data + 6) != 0x8051)
+		if (READ_UINT16_BE(data.data + 6) != 0x8050 && READ_UINT16_BE(data.data + 6) != 0x8051)
 			return false;
 
-		soundHeaderOffset = READ_UINT32_BE(data->data + 10);
+		soundHeaderOffset = READ_UINT32_BE(data.data + 10);
 	}
 
-	if (READ_UINT32_BE(data->data + soundHeaderOffset) != 0)
+	if (READ_UINT32_BE(data.data + soundHeaderOffset) != 0)
 		return false;
 
-	uint32 length = READ_UINT32_BE(data->data + soundHeaderOffset + 4);
-	uint16 audioRate = READ_UINT16_BE(data->data + soundHeaderOffset + 8);
+	uint32 length = READ_UINT32_BE(data.data + soundHeaderOffset + 4);
+	uint16 audioRate = READ_UINT16_BE(data.data + soundHeaderOffset + 8);
 
-	if (*(data->data + soundHeaderOffset + 20) != 0)
+	if (*(data.data + soundHeaderOffset + 20) != 0)
 		return false;
 
-	fileName = addExtension(fileName, ".wav");
-
-	FILE *output = fopen(fileName.c_str(), "wb");
-
-	if (!output) {
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, fileName)) {
 		fprintf(stderr, "Could not open '%s' for writing\n", fileName.c_str());
 		return false;
 	}
 
+	FILE *output = outputFile.getFile();
+
 	writeUint32BE(output, 'RIFF');
 	writeUint32LE(output, length + 44);
 	writeUint32BE(output, 'WAVE');
@@ -184,113 +397,354 @@ bool outputMacSnd(DataPair *data, std::string fileName) {
 	writeUint32BE(output, 'data');
 	writeUint32LE(output, length);
 
-	fwrite(data->data + soundHeaderOffset + 22, 1, length, output);
-	fflush(output);
-	fclose(output);
-	return true;
+	fwrite(data.data + soundHeaderOffset + 22, 1, length, output);
+	return outputFile.commit();
 }
 
-struct IconInfo {
-	uint32 tag;
-	DataPair *data;
-};
+bool outputMacSnd(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options) {
+	return outputMacSnd(pair, outputDir, fileName);
+}
 
-typedef std::vector<IconInfo> IconList;
-typedef std::map<uint16, IconList> IconMap;
+// Text goes either into a .txt file per resource, or with --jsonl, into one
+// JSON object per resource on stdout
+bool outputText(ResourceFork &resFork, uint32 tag, uint16 id, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options, const std::vector<std::string> &strings, bool isList) {
+	if (options.jsonl) {
+		std::string json = "{\"type\":" + escapeJSONString(convertMacRomanToUTF8(tagToString(tag)));
+		json += ",\"id\":" + std::to_string((int16)id);
+		json += ",\"name\":" + escapeJSONString(convertMacRomanToUTF8(resFork.getFilename(tag, id)));
 
-bool outputIcons(ResourceFork &resFork) {
-	IconMap icons;
+		if (isList) {
+			json += ",\"strings\":[";
 
-	std::vector<uint32> typeList = resFork.getTagArray();
+			for (uint32 i = 0; i < strings.size(); i++) {
+				if (i != 0)
+					json += ',';
 
-	for (uint32 i = 0; i < typeList.size(); i++) {
-		// Known types of icons
-		switch (typeList[i]) {
-		case 'ICON':
-		case 'ICN#':
-		case 'icm#':
-		case 'icm4':
-		case 'icm8':
-		case 'ics#':
-		case 'ics4':
-		case 'ics8':
-		case 'is32':
-		case 's8mk':
-		case 'icl4':
-		case 'icl8':
-		case 'il32':
-		case 'l8mk':
-		case 'ich#':
-		case 'ich4':
-		case 'ich8':
-		case 'ih32':
-		case 'h8mk':
-		case 'it32':
-		case 't8mk':
-			break;
-		default:
-			continue;
+				json += escapeJSONString(strings[i]);
+			}
+
+			json += "]}\n";
+		} else {
+			json += ",\"text\":" + escapeJSONString(strings.empty() ? std::string() : strings[0]) + "}\n";
 		}
 
-		std::vector<uint16> idList = resFork.getIDArray(typeList[i]);
+		// Workers converting other files share stdout
+		static std::mutex jsonMutex;
+		std::lock_guard<std::mutex> lock(jsonMutex);
+		fwrite(json.c_str(), 1, json.size(), stdout);
+		return true;
+	}
 
-		for (uint32 j = 0; j < idList.size(); j++) {
-			IconInfo info;
-			info.tag = typeList[i];
-			info.data = resFork.getResource(typeList[i], idList[j]);
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, fileName)) {
+		fprintf(stderr, "Could not open '%s' for writing\n", fileName.c_str());
+		return false;
+	}
 
-			if (info.data->length != 0)
-				icons[idList[j]].push_back(info);
-		}
+	FILE *output = outputFile.getFile();
+
+	for (uint32 i = 0; i < strings.size(); i++) {
+		fwrite(strings[i].c_str(), 1, strings[i].size(), output);
+
+		if (isList || strings[i].empty() || strings[i][strings[i].size() - 1] != '\n')
+			writeByte(output, '\n');
 	}
 
-	if (icons.empty())
+	return outputFile.commit();
+}
+
+bool outputString(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options) {
+	std::vector<std::string> strings;
+
+	if (!parsePascalStrings(pair.data, pair.length, 1, strings)) {
+		fprintf(stderr, "Bad string in '%s' %04x\n", tagToString(tag).c_str(), id);
+		return false;
+	}
+
+	return outputText(resFork, tag, id, outputDir, fileName, options, strings, false);
+}
+
+bool outputStringList(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options) {
+	std::vector<std::string> strings;
+
+	if (!parseStringList(pair.data, pair.length, strings)) {
+		fprintf(stderr, "Bad string list in '%s' %04x\n", tagToString(tag).c_str(), id);
 		return false;
+	}
+
+	return outputText(resFork, tag, id, outputDir, fileName, options, strings, true);
+}
+
+bool outputTextResource(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options) {
+	std::vector<std::string> strings(1);
+	appendMacRomanAsUTF8(pair.data, pair.length, strings[0], true);
+
+	return outputText(resFork, tag, id, outputDir, fileName, options, strings, false);
+}
+
+enum {
+	kConverterStreams = 1 << 0,   // Copies through readResourceChunks(), never holding the whole payload
+	kConverterIconFamily = 1 << 1 // Gathered by ID across types and written by outputIcons()
+};
+
+// pair holds the whole resource, except for kConverterStreams converters,
+// which copy it out through readResourceChunks() as they go
+typedef bool (*ConverterProc)(ResourceFork &resFork, uint32 tag, uint16 id, const DataPair &pair, OutputDirectory &outputDir, const std::string &fileName, const OptionSet &options);
+
+struct Converter {
+	uint32 tag;
+	ConverterProc proc;
+	const char *extension;
+	uint32 flags;
+};
 
-	for (IconMap::iterator it = icons.begin(); it != icons.end(); it++) {
-		char name[10];
-		sprintf(name, "%04x.icns", it->first);
+// Keep this sorted by tag; it's binary searched
+static constexpr Converter s_converters[] = {
+	{ 'IBIN', outputPICT, ".pict", kConverterStreams }, // PICT in various SCI games
+	{ 'IBIS', outputPICT, ".pict", kConverterStreams }, // Ditto
+	{ 'ICN#', 0, 0, kConverterIconFamily },
+	{ 'ICON', 0, 0, kConverterIconFamily },
+	{ 'JPEG', outputRawResource, ".jpg", kConverterStreams },
+	{ 'PICT', outputPICT, ".pict", kConverterStreams },
+	{ 'STR ', outputString, ".txt", 0 },
+	{ 'STR#', outputStringList, ".txt", 0 },
+	{ 'TEXT', outputTextResource, ".txt", 0 },
+	{ 'h8mk', 0, 0, kConverterIconFamily },
+	{ 'ich#', 0, 0, kConverterIconFamily },
+	{ 'ich4', 0, 0, kConverterIconFamily },
+	{ 'ich8', 0, 0, kConverterIconFamily },
+	{ 'icl4', 0, 0, kConverterIconFamily },
+	{ 'icl8', 0, 0, kConverterIconFamily },
+	{ 'icm#', 0, 0, kConverterIconFamily },
+	{ 'icm4', 0, 0, kConverterIconFamily },
+	{ 'icm8', 0, 0, kConverterIconFamily },
+	{ 'icns', outputRawResource, ".icns", kConverterStreams },
+	{ 'ics#', 0, 0, kConverterIconFamily },
+	{ 'ics4', 0, 0, kConverterIconFamily },
+	{ 'ics8', 0, 0, kConverterIconFamily },
+	{ 'ih32', 0, 0, kConverterIconFamily },
+	{ 'il32', 0, 0, kConverterIconFamily },
+	{ 'is32', 0, 0, kConverterIconFamily },
+	{ 'it32', 0, 0, kConverterIconFamily },
+	{ 'j3rs', outputPICT, ".pict", kConverterStreams }, // PICT in Legacy of Time
+	{ 'l8mk', 0, 0, kConverterIconFamily },
+	{ 's8mk', 0, 0, kConverterIconFamily },
+	{ 'snd ', outputMacSnd, ".wav", 0 },
+	{ 't8mk', 0, 0, kConverterIconFamily }
+};
 
-		FILE *output = fopen(name, "wb");
-		if (!output) {
-			fprintf(stderr, "Failed to open '%s' for writing\n", name);
+static constexpr bool isConverterListSorted() {
+	for (uint32 i = 1; i < sizeof(s_converters) / sizeof(s_converters[0]); i++)
+		if (s_converters[i - 1].tag >= s_converters[i].tag)
 			return false;
-		}
 
-		IconList &list = it->second;
+	return true;
+}
+
+static_assert(isConverterListSorted(), "s_converters has to be sorted by tag");
 
+static bool compareConverterTag(const Converter &converter, uint32 tag) {
+	return converter.tag < tag;
+}
+
+// Resolve a type (or its --alias) to a converter, or 0 for none
+const Converter *findConverter(uint32 tag, const TagAliasMap &aliases) {
+	TagAliasMap::const_iterator alias = aliases.find(tag);
+	if (alias != aliases.end())
+		tag = alias->second;
+
+	const Converter *end = s_converters + sizeof(s_converters) / sizeof(s_converters[0]);
+	const Converter *converter = std::lower_bound(s_converters, end, tag, compareConverterTag);
+
+	if (converter == end || converter->tag != tag)
+		return 0;
+
+	return converter;
+}
+
+// Icon types sharing an ID make up one family, which becomes one .icns file
+struct IconMember {
+	uint32 tag;        // In the fork
+	uint32 iconType;   // In the .icns, which differs for aliased types
+};
+
+typedef std::map<uint16, std::vector<IconMember> > IconFamilyMap;
+
+// Works on a single fork or a chain of them; with a chain, each member
+// comes from whichever fork serves it, as with GetResource()
+template<class Resources>
+bool outputIconFamily(Resources &resources, OutputDirectory &outputDir, const std::string &outputPrefix, uint16 id, const std::vector<IconMember> &members) {
+	// Size everything up front, so the header can be written before any data
+	std::vector<uint32> sizes(members.size());
+
+	for (uint32 i = 0; i < members.size(); i++)
+		sizes[i] = resources.getResourceSize(members[i].tag, id);
+
+	char name[10];
+	sprintf(name, "%04x.icns", id);
+
+	std::string fileName = outputDir.getPath(outputPrefix, 'icns', id, name);
+
+	// A member that can't be read (say, one that fails to decompress) would
+	// leave the sizes in the header wrong, so start over without it
+	for (;;) {
 		uint32 totalSize = 8;
-		for (IconList::const_iterator it = list.begin(); it != list.end(); it++)
-			totalSize += it->data->length + 8;
+
+		for (uint32 i = 0; i < members.size(); i++)
+			if (sizes[i] != 0)
+				totalSize += sizes[i] + 8;
+
+		if (totalSize == 8)
+			return false;
+
+		OutputFile outputFile;
+		if (!outputFile.open(outputDir, fileName)) {
+			fprintf(stderr, "Failed to open '%s' for writing\n", fileName.c_str());
+			return false;
+		}
+
+		FILE *output = outputFile.getFile();
 
 		writeUint32BE(output, 'icns');
 		writeUint32BE(output, totalSize);
 
-		for (IconList::iterator it = list.begin(); it != list.end(); it++) {
-			IconInfo &info = *it;
-			writeUint32BE(output, info.tag);
-			writeUint32BE(output, info.data->length + 8);
-			fwrite(info.data->data, 1, info.data->length, output);
-			delete info.data;
+		// Each payload gets streamed straight from the fork into the file
+		uint32 i;
+		for (i = 0; i < members.size(); i++) {
+			if (sizes[i] == 0)
+				continue;
+
+			writeUint32BE(output, members[i].iconType);
+			writeUint32BE(output, sizes[i] + 8);
+
+			if (!resources.writeResource(members[i].tag, id, output))
+				break;
 		}
 
-		fflush(output);
-		fclose(output);
+		if (i == members.size())
+			return outputFile.commit();
+
+		fprintf(stderr, "Leaving '%s' %d out of '%s'\n", tagToString(members[i].tag).c_str(), id, fileName.c_str());
+		sizes[i] = 0;
+	}
+}
+
+template<class Resources>
+struct IconJob {
+	Resources *resources;
+	OutputDirectory *outputDir;
+	const std::string *outputPrefix;
+	std::vector<IconFamilyMap::const_iterator> families;
+	std::atomic<uint32> nextFamily;
+};
+
+template<class Resources>
+static void processIconFamilies(IconJob<Resources> *job) {
+	for (;;) {
+		uint32 i = job->nextFamily++;
+		if (i >= job->families.size())
+			break;
+
+		outputIconFamily(*job->resources, *job->outputDir, *job->outputPrefix, job->families[i]->first, job->families[i]->second);
+	}
+}
+
+template<class Resources>
+bool outputIcons(Resources &resources, OutputDirectory &outputDir, const std::string &outputPrefix, const TagAliasMap &aliases, uint jobCount) {
+	// Only the map is needed to group the families
+	IconFamilyMap icons;
+
+	std::vector<uint32> typeList = resources.getTagArray();
+
+	for (uint32 i = 0; i < typeList.size(); i++) {
+		const Converter *converter = findConverter(typeList[i], aliases);
+		if (!converter || !(converter->flags & kConverterIconFamily))
+			continue;
+
+		IconMember member;
+		member.tag = typeList[i];
+		member.iconType = converter->tag;
+
+		std::vector<uint16> idList = resources.getIDArray(typeList[i]);
+
+		for (uint32 j = 0; j < idList.size(); j++)
+			icons[idList[j]].push_back(member);
 	}
 
+	if (icons.empty())
+		return false;
+
+	IconJob<Resources> job;
+	job.resources = &resources;
+	job.outputDir = &outputDir;
+	job.outputPrefix = &outputPrefix;
+	job.nextFamily = 0;
+
+	for (IconFamilyMap::const_iterator it = icons.begin(); it != icons.end(); it++)
+		job.families.push_back(it);
+
+	if (jobCount > job.families.size())
+		jobCount = job.families.size();
+
+	std::vector<std::thread> threads;
+	for (uint i = 1; i < jobCount; i++)
+		threads.push_back(std::thread(processIconFamilies<Resources>, &job));
+
+	// This thread pitches in too
+	processIconFamilies(&job);
+
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+
 	return true;
 }
 
-void doMode(ResourceFork &resFork, const OptionSet &options) {
+// doMode() works on a single fork or on a chain of them; these cover
+// where the two differ
+
+static ResourceFork &getServingFork(ResourceFork &resFork, uint32 tag, uint16 id) {
+	return resFork;
+}
+
+static ResourceFork &getServingFork(ResourceChain &chain, uint32 tag, uint16 id) {
+	return *chain.findFork(tag, id);
+}
+
+static void printForkName(ResourceFork &resFork, uint32 tag, uint16 id) {
+}
+
+static void printForkName(ResourceChain &chain, uint32 tag, uint16 id) {
+	ResourceFork *resFork = chain.findFork(tag, id);
+
+	for (uint32 i = 0; i < chain.getForkCount(); i++)
+		if (chain.getFork(i) == resFork)
+			printf(" (%s)", chain.getForkName(i).c_str());
+}
+
+template<class Resources>
+void doMode(Resources &resources, const OptionSet &options, OutputDirectory &outputDir, const std::string &outputPrefix) {
 	if (options.mode == kRunModeUnk)
 		return;
 
-	std::vector<uint32> typeList = resFork.getTagArray();
+	std::vector<uint32> typeList = resources.getTagArray();
 
 	for (uint32 i = 0; i < typeList.size(); i++) {
-		std::vector<uint16> idList = resFork.getIDArray(typeList[i]);
+		// Converters are picked once per type
+		const Converter *converter = 0;
+
+		if (options.mode == kRunModeConvert) {
+			converter = findConverter(typeList[i], options.aliases);
+
+			if (!converter || (converter->flags & kConverterIconFamily))
+				continue;
+		}
+
+		std::vector<uint16> idList = resources.getIDArray(typeList[i]);
 		
 		for (uint32 j = 0; j < idList.size(); j++) {
+			ResourceFork &resFork = getServingFork(resources, typeList[i], idList[j]);
+			std::string fileName;
+
 			if (options.mode == kRunModeList) {
 				printf("%c%c%c%c %04x", typeList[i] >> 24, (typeList[i] >> 16) & 0xff, (typeList[i] >> 8) & 0xff, typeList[i] & 0xff, idList[j]);
 
@@ -299,69 +753,558 @@ void doMode(ResourceFork &resFork, const OptionSet &options) {
 				if (!filename.empty())
 					printf(" - %s", filename.c_str());
 
+				printForkName(resources, typeList[i], idList[j]);
 				printf("\n");
 			} else if (options.mode == kRunModeConvert) {
-				if (typeList[i] == 'PICT' || typeList[i] == 'j3rs' || typeList[i] == 'IBIN' || typeList[i] == 'IBIS') {
-					// 'j3rs' is PICT in Legacy of Time
-					// 'IBIN' and 'IBIS' are PICT in various SCI games
-					DataPair *pair = resFork.getResource(typeList[i], idList[j]);
-					outputPICT(pair, resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]));
-					delete pair;
-				} else if (typeList[i] == 'snd ') {
-					DataPair *pair = resFork.getResource(typeList[i], idList[j]);
-					outputMacSnd(pair, resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]));
-					delete pair;
-				} else if (typeList[i] == 'JPEG') {
-					DataPair *pair = resFork.getResource(typeList[i], idList[j]);
-					outputDataPair(pair, addExtension(resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]), ".jpg"));
-					delete pair;
-				} else if (typeList[i] == 'icns') {
-					DataPair *pair = resFork.getResource(typeList[i], idList[j]);
-					outputDataPair(pair, addExtension(resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]), ".icns"));
-					delete pair;
+				// Only converters that can't stream get the whole payload
+				DataPair pair;
+
+				if (!(converter->flags & kConverterStreams)) {
+					pair = resFork.getResource(typeList[i], idList[j]);
+
+					if (!pair) {
+						fprintf(stderr, "Failed to read '%s' %04x\n", tagToString(typeList[i]).c_str(), idList[j]);
+						continue;
+					}
 				}
+
+				fileName = outputDir.getPath(outputPrefix, typeList[i], idList[j], resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]));
+				converter->proc(resFork, typeList[i], idList[j], pair, outputDir, addExtension(fileName, converter->extension), options);
 			} else {
-				DataPair *pair = resFork.getResource(typeList[i], idList[j]);
-				outputDataPair(pair, resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]));
-				delete pair;
+				fileName = outputDir.getPath(outputPrefix, typeList[i], idList[j], resFork.createOutputFilename(options.useFileNames, typeList[i], idList[j]));
+				dumpResource(resFork, typeList[i], idList[j], outputDir, fileName);
 			}
 		}
 	}
 
 	if (options.mode == kRunModeConvert)
-		outputIcons(resFork);
+		outputIcons(resources, outputDir, outputPrefix, options.aliases, options.jobCount);
+}
 
-	printf("\nAll done!\n");
+bool doChain(const OptionSet &options, OutputDirectory &outputDir) {
+	if (options.mode != kRunModeList && options.mode != kRunModeDump && options.mode != kRunModeConvert) {
+		printf("--chain only works with list, dump, or convert\n");
+		return false;
+	}
+
+	// The file named last on the command line comes first in the chain
+	std::vector<const char *> forkNames;
+	forkNames.push_back(options.inputName);
+	forkNames.insert(forkNames.end(), options.chainNames.begin(), options.chainNames.end());
+
+	ResourceChain chain;
+
+	for (uint32 i = 0; i < forkNames.size(); i++) {
+		if (!chain.addFork(forkNames[i])) {
+			printf("Failed to open file '%s'\n", forkNames[i]);
+			return false;
+		}
+	}
+
+	doMode(chain, options, outputDir, "");
+	return true;
+}
+
+struct VolumeJob {
+	const char *imageName;
+	const HFSVolume *volume;
+	const OptionSet *options;
+	OutputDirectory *outputDir;
+	std::atomic<uint32> nextFile;
+	std::mutex listMutex;
+};
+
+static void processVolumeFiles(VolumeJob *job) {
+	// Each worker gets its own handle so the seeks don't fight
+	FILE *image = fopen(job->imageName, "rb");
+
+	if (!image)
+		return;
+
+	const std::vector<HFSFile> &files = job->volume->getFiles();
+
+	// The files are already spread over the workers
+	OptionSet fileOptions = *job->options;
+	fileOptions.jobCount = 1;
+
+	for (;;) {
+		uint32 i = job->nextFile++;
+		if (i >= files.size())
+			break;
+
+		ResourceFork resFork;
+		if (!resFork.load(job->volume->createResourceForkStream(image, files[i]))) {
+			fprintf(stderr, "Failed to load the resource fork of '%s'\n", files[i].path.c_str());
+			continue;
+		}
+
+		if (fileOptions.mode == kRunModeList) {
+			// Keep each file's listing together
+			std::lock_guard<std::mutex> lock(job->listMutex);
+			printf("\n%s:\n", files[i].path.c_str());
+			doMode(resFork, fileOptions, *job->outputDir, "");
+		} else {
+			// Mirror the volume's folder layout
+			doMode(resFork, fileOptions, *job->outputDir, files[i].path + "/");
+		}
+	}
+
+	fclose(image);
+}
+
+void doVolume(const HFSVolume &volume, const OptionSet &options, OutputDirectory &outputDir) {
+	VolumeJob job;
+	job.imageName = options.inputName;
+	job.volume = &volume;
+	job.options = &options;
+	job.outputDir = &outputDir;
+	job.nextFile = 0;
+
+	std::vector<std::thread> threads;
+	for (uint i = 0; i < options.jobCount; i++)
+		threads.push_back(std::thread(processVolumeFiles, &job));
+
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+bool extractFork(const char *inputName, OutputDirectory &outputDir, const ForkLocation &location) {
+	FILE *input = fopen(inputName, "rb");
+
+	if (!input)
+		return false;
+
+	char name[32];
+	sprintf(name, "%012llx.rsrc", (unsigned long long)location.offset);
+
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, name)) {
+		fprintf(stderr, "Could not open '%s' for writing\n", name);
+		fclose(input);
+		return false;
+	}
+
+	FILE *output = outputFile.getFile();
+
+	seekFile(input, location.offset);
+
+	byte buffer[64 * 1024];
+	uint64 bytesLeft = location.size;
+
+	while (bytesLeft > 0) {
+		uint32 chunkSize = (bytesLeft < sizeof(buffer)) ? bytesLeft : sizeof(buffer);
+
+		if (fread(buffer, 1, chunkSize, input) != chunkSize)
+			break;
+
+		fwrite(buffer, 1, chunkSize, output);
+		bytesLeft -= chunkSize;
+	}
+
+	fclose(input);
+	return bytesLeft == 0 && outputFile.commit();
+}
+
+void doScan(const OptionSet &options, OutputDirectory &outputDir) {
+	std::vector<ForkLocation> forks = scanForResourceForks(options.inputName, options.jobCount);
+
+	for (uint32 i = 0; i < forks.size(); i++) {
+		printf("%012llx %10llu bytes, %d types\n", (unsigned long long)forks[i].offset, (unsigned long long)forks[i].size, forks[i].typeCount);
+
+		if (options.extract)
+			extractFork(options.inputName, outputDir, forks[i]);
+	}
+
+	printf("\nFound %d resource forks\n", (int)forks.size());
+}
+
+bool doRepack(ResourceFork &resFork, const OptionSet &options, OutputDirectory &outputDir) {
+	// Name the output after the input, minus any directory and extension
+	std::string baseName = options.inputName;
+
+	std::string::size_type slash = baseName.find_last_of('/');
+	if (slash != std::string::npos)
+		baseName = baseName.substr(slash + 1);
+
+	std::string::size_type dot = baseName.find_last_of('.');
+	if (dot != std::string::npos && dot != 0)
+		baseName = baseName.substr(0, dot);
+
+	std::string fileName;
+	if (options.container == kForkContainerMacBinary)
+		fileName = baseName + ".bin";
+	else if (options.container == kForkContainerAppleDouble)
+		fileName = "._" + baseName;
+	else
+		fileName = baseName + ".rsrc";
+
+	ResourceForkWriter writer(resFork);
+	writer.setDeduplicate(options.deduplicate);
+
+	for (uint32 i = 0; i < options.strippedTypes.size(); i++)
+		writer.stripType(options.strippedTypes[i]);
+
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, fileName)) {
+		printf("Failed to create '%s'\n", fileName.c_str());
+		return false;
+	}
+
+	if (!writer.write(outputFile.getFile(), options.container, baseName) || !outputFile.commit()) {
+		printf("Failed to write '%s'\n", fileName.c_str());
+		return false;
+	}
+
+	printf("Wrote %d resources (%d duplicates merged) to '%s'\n", writer.getResourceCount(), writer.getDuplicateCount(), fileName.c_str());
+	return true;
+}
+
+bool parseHexPattern(const char *desc, std::string &pattern) {
+	pattern.clear();
+
+	for (;;) {
+		while (*desc == ' ')
+			desc++;
+
+		if (!*desc)
+			break;
+
+		if (!isxdigit((byte)desc[0]) || !isxdigit((byte)desc[1]))
+			return false;
+
+		char digits[3] = { desc[0], desc[1], 0 };
+		pattern += (char)strtol(digits, 0, 16);
+		desc += 2;
+	}
+
+	return !pattern.empty();
+}
+
+bool doGrep(const OptionSet &options) {
+	std::vector<std::string> patterns;
+
+	for (uint32 i = 0; i < options.patterns.size(); i++) {
+		std::string pattern = options.patterns[i].desc;
+
+		if (options.patterns[i].isHex) {
+			if (!parseHexPattern(options.patterns[i].desc, pattern)) {
+				printf("Bad hex pattern '%s'\n", options.patterns[i].desc);
+				return false;
+			}
+		} else if (options.macRoman && !convertUTF8ToMacRoman(options.patterns[i].desc, pattern)) {
+			printf("'%s' can't be written in MacRoman\n", options.patterns[i].desc);
+			return false;
+		}
+
+		if (pattern.empty()) {
+			printf("Empty search pattern\n");
+			return false;
+		}
+
+		patterns.push_back(pattern);
+	}
+
+	if (patterns.empty()) {
+		printf("Nothing to search for; use --hex or --string\n");
+		return false;
+	}
+
+	std::vector<ResourceFork *> forks;
+	std::vector<const char *> forkNames;
+
+	for (uint32 i = 0; i < options.inputNames.size(); i++) {
+		ResourceFork *resFork = new ResourceFork();
+
+		if (resFork->load(options.inputNames[i])) {
+			forks.push_back(resFork);
+			forkNames.push_back(options.inputNames[i]);
+		} else {
+			printf("Failed to open file '%s'\n", options.inputNames[i]);
+			delete resFork;
+		}
+	}
+
+	std::vector<GrepMatch> matches = grepResourceForks(forks, patterns, options.jobCount);
+
+	for (uint32 i = 0; i < matches.size(); i++) {
+		const GrepMatch &match = matches[i];
+		ResourceFork *resFork = forks[match.forkIndex];
+
+		printf("%s: %s %04x", forkNames[match.forkIndex], tagToString(match.tag).c_str(), match.id);
+
+		std::string name = resFork->getFilename(match.tag, match.id);
+		if (!name.empty())
+			printf(" - %s", convertMacRomanToUTF8(name).c_str());
+
+		printf(" @ 0x%08x '%s'\n", match.offset, options.patterns[match.patternIndex].desc);
+	}
+
+	printf("\nFound %d matches\n", (int)matches.size());
+
+	for (uint32 i = 0; i < forks.size(); i++)
+		delete forks[i];
+
+	return true;
+}
+
+bool doIndex(const OptionSet &options, OutputDirectory &outputDir) {
+	// Whatever was indexed last time saves re-reading unchanged files
+	std::string catalogPath = std::string(options.outputDirName) + "/" + options.catalogName;
+
+	Catalog previous;
+	previous.open(catalogPath.c_str());
+
+	std::vector<CatalogFile> files;
+	IndexStats stats;
+	indexDirectory(options.inputName, catalogPath, previous, options.jobCount, files, stats);
+
+	uint32 resourceCount = 0;
+	for (uint32 i = 0; i < files.size(); i++)
+		resourceCount += files[i].resources.size();
+
+	OutputFile outputFile;
+	if (!outputFile.open(outputDir, options.catalogName) || !writeCatalog(outputFile.getFile(), files) || !outputFile.commit()) {
+		printf("Failed to write catalog '%s'\n", catalogPath.c_str());
+		return false;
+	}
+
+	printf("Indexed %d files (%d unchanged, %d parsed, %d not resource forks), %d resources\n",
+			(int)files.size(), stats.reusedCount, stats.parsedCount, stats.nonForkCount, resourceCount);
+	return true;
+}
+
+bool doQuery(const OptionSet &options) {
+	Catalog catalog;
+	if (!catalog.open(options.inputName)) {
+		printf("Failed to open catalog '%s'\n", options.inputName);
+		return false;
+	}
+
+	// Use the most selective index available, then filter on the rest
+	std::vector<uint32> postings;
+
+	if (options.queryName) {
+		std::string name;
+		if (!convertUTF8ToMacRoman(options.queryName, name))
+			name = options.queryName;
+
+		postings = catalog.findByName(name);
+	} else if (options.hasQueryTag && options.hasQueryID) {
+		postings = catalog.findByTagAndID(options.queryTag, options.queryID);
+	} else if (options.hasQueryTag) {
+		postings = catalog.findByTag(options.queryTag);
+	} else if (options.hasQueryID) {
+		postings = catalog.findByID(options.queryID);
+	} else {
+		printf("Nothing to look for; use --type, --id, or --name\n");
+		return false;
+	}
+
+	uint32 matchCount = 0;
+	std::set<uint32> matchedFiles;
+
+	for (uint32 i = 0; i < postings.size(); i++) {
+		Catalog::Posting posting = catalog.getPosting(postings[i]);
+
+		if ((options.hasQueryTag && posting.tag != options.queryTag) || (options.hasQueryID && posting.id != options.queryID))
+			continue;
+
+		printf("%s: %s %04x", catalog.getFilePath(posting.fileIndex).c_str(), tagToString(posting.tag).c_str(), posting.id);
+
+		if (posting.nameIndex != Catalog::NO_NAME)
+			printf(" - %s", convertMacRomanToUTF8(catalog.getName(posting.nameIndex)).c_str());
+
+		printf("\n");
+		matchCount++;
+		matchedFiles.insert(posting.fileIndex);
+	}
+
+	printf("\nFound %d resources in %d files\n", matchCount, (int)matchedFiles.size());
+	return true;
+}
+
+struct WatchJob {
+	OptionSet fileOptions;
+	OutputDirectory *outputDir;
+	std::mutex listMutex;
+};
+
+static void processWatchedFile(const std::string &path, void *context) {
+	WatchJob *job = (WatchJob *)context;
+
+	ResourceFork resFork;
+	if (!resFork.load(path.c_str())) {
+		fprintf(stderr, "Failed to load a resource fork from '%s'\n", path.c_str());
+		return;
+	}
+
+	// Each file gets a folder named after it, as with disk images
+	std::string fileName = path.substr(path.find_last_of('/') + 1);
+
+	if (job->fileOptions.mode == kRunModeList) {
+		std::lock_guard<std::mutex> lock(job->listMutex);
+		printf("\n%s:\n", fileName.c_str());
+		doMode(resFork, job->fileOptions, *job->outputDir, "");
+	} else {
+		doMode(resFork, job->fileOptions, *job->outputDir, fileName + "/");
+	}
+}
+
+bool doWatch(const OptionSet &options, OutputDirectory &outputDir) {
+	if (options.watchMode != kRunModeList && options.watchMode != kRunModeDump && options.watchMode != kRunModeConvert) {
+		printf("watch can only be followed by list, dump, or convert\n");
+		return false;
+	}
+
+	// The files are spread over the workers, like a disk image's
+	WatchJob job;
+	job.fileOptions = options;
+	job.fileOptions.mode = options.watchMode;
+	job.fileOptions.jobCount = 1;
+	job.outputDir = &outputDir;
+
+	return watchDirectory(options.inputName, options.jobCount, options.settleTime, processWatchedFile, &job);
+}
+
+void printDifferenceJSON(const ResourceDifference &difference) {
+	const char *change = "changed";
+	if (difference.flags & kDiffAdded)
+		change = "added";
+	else if (difference.flags & kDiffRemoved)
+		change = "removed";
+	else if (!(difference.flags & kDiffChanged))
+		change = "renamed";
+
+	printf("{\"change\":\"%s\",\"type\":%s,\"id\":%d", change,
+			escapeJSONString(convertMacRomanToUTF8(tagToString(difference.tag))).c_str(), (int16)difference.id);
+
+	if (!(difference.flags & kDiffAdded))
+		printf(",\"oldName\":%s,\"oldSize\":%d", escapeJSONString(convertMacRomanToUTF8(difference.oldName)).c_str(), difference.oldSize);
+
+	if (!(difference.flags & kDiffRemoved))
+		printf(",\"newName\":%s,\"newSize\":%d", escapeJSONString(convertMacRomanToUTF8(difference.newName)).c_str(), difference.newSize);
+
+	printf(",\"renamed\":%s}\n", (difference.flags & kDiffRenamed) ? "true" : "false");
+}
+
+bool doDiff(const OptionSet &options) {
+	ResourceFork oldFork, newFork;
+
+	if (!oldFork.load(options.baseInputName)) {
+		fprintf(stderr, "Failed to open file '%s'\n", options.baseInputName);
+		return false;
+	}
+
+	if (!newFork.load(options.inputName)) {
+		fprintf(stderr, "Failed to open file '%s'\n", options.inputName);
+		return false;
+	}
+
+	std::vector<ResourceDifference> differences = diffResourceForks(oldFork, newFork, options.jobCount);
+	uint32 added = 0, removed = 0, changed = 0, renamed = 0;
+
+	for (uint32 i = 0; i < differences.size(); i++) {
+		const ResourceDifference &difference = differences[i];
+
+		if (options.jsonl) {
+			printDifferenceJSON(difference);
+			continue;
+		}
+
+		if (difference.flags & kDiffAdded) {
+			printf("A %s %04x (%d bytes)\n", tagToString(difference.tag).c_str(), difference.id, difference.newSize);
+			added++;
+		} else if (difference.flags & kDiffRemoved) {
+			printf("D %s %04x (%d bytes)\n", tagToString(difference.tag).c_str(), difference.id, difference.oldSize);
+			removed++;
+		} else {
+			if (difference.flags & kDiffChanged) {
+				printf("M %s %04x (%d -> %d bytes)\n", tagToString(difference.tag).c_str(), difference.id, difference.oldSize, difference.newSize);
+				changed++;
+			}
+
+			if (difference.flags & kDiffRenamed) {
+				printf("R %s %04x \"%s\" -> \"%s\"\n", tagToString(difference.tag).c_str(), difference.id,
+						convertMacRomanToUTF8(difference.oldName).c_str(), convertMacRomanToUTF8(difference.newName).c_str());
+				renamed++;
+			}
+		}
+	}
+
+	if (!options.jsonl)
+		printf("\n%d added, %d removed, %d changed, %d renamed\n", added, removed, changed, renamed);
+
+	return true;
 }
 
 void printUsage(const char *appName) {
 	printf("Usage: %s <mode> [<options>] <file name>\n", appName);
+	printf("       %s diff [<options>] <old file name> <new file name>\n", appName);
+	printf("       %s grep [<options>] <file name> [<file name> ...]\n", appName);
+	printf("       %s index [<options>] <directory>\n", appName);
+	printf("       %s query [<options>] <catalog file>\n", appName);
+	printf("       %s watch [<options>] <directory>\n", appName);
 	printf("\n");
 	printf("Valid Modes:\n");
 	printf("================================================================================\n");
 	printf("\tlist\t\t\tList all resources in the resource fork.\n");
 	printf("\tdump\t\t\tDump all resources (as-is) in the resource\n\t\t\t\tfork.\n");
 	printf("\tconvert\t\t\tConvert all known resources types in the\n\t\t\t\tresource fork.\n");
+	printf("\tscan\t\t\tSearch a disk/CD image for embedded resource\n\t\t\t\tforks.\n");
+	printf("\tdiff\t\t\tReport resources added, removed, changed or\n\t\t\t\trenamed between two resource forks.\n");
+	printf("\trepack\t\t\tWrite a compacted copy of the resource fork.\n");
+	printf("\tgrep\t\t\tSearch every resource in one or more forks\n\t\t\t\tfor byte patterns.\n");
+	printf("\tindex\t\t\tCatalog the resources of every fork under a\n\t\t\t\tdirectory, updating an existing catalog.\n");
+	printf("\tquery\t\t\tLook up resources by type, ID or name in a\n\t\t\t\tcatalog.\n");
+	printf("\twatch\t\t\tProcess files as they arrive in a directory\n\t\t\t\t(Linux only).\n");
+	printf("\n");
+	printf("The file may also be an HFS or HFS+ disk image, in which case every resource\n");
+	printf("fork on the volume is processed and output goes into matching folders.\n");
 	printf("\n");
 	printf("Currently, the 'convert' mode will dump any PICT resource as a proper PICT file\n");
 	printf("and dumps snd resources as wave files. It also relabels JPEG files and can\n");
-	printf("dump out icons into .icns files.\n");
+	printf("dump out icons into .icns files. Text in 'STR ', 'STR#' and 'TEXT' resources\n");
+	printf("is converted to UTF-8 .txt files.\n");
 	printf("\n");
 	printf("Options:\n");
 	printf("================================================================================\n");
 	printf("\t--use-file-names\tAttempt to use the built-in file names for\n\t\t\t\tresources for output.\n");
+	printf("\t--extract\t\tWhen scanning, write each resource fork found\n\t\t\t\tto <offset>.rsrc.\n");
+	printf("\t--jobs <count>\t\tNumber of threads to use when scanning or\n\t\t\t\tprocessing a disk image.\n");
+	printf("\t--output-dir <path>\tWrite output files into <path> instead of the\n\t\t\t\tcurrent directory.\n");
+	printf("\t--shard <layout>\tSplit output into subdirectories by 'type',\n\t\t\t\t'id' (high byte), or 'type,id'.\n");
+	printf("\t--jsonl\t\t\tWhen diffing, or converting text resources,\n\t\t\t\tprint one JSON object per line instead.\n");
+	printf("\t--format <format>\tWhen repacking, write 'raw' (default),\n\t\t\t\t'macbinary', or 'appledouble' output.\n");
+	printf("\t--strip <type>\t\tWhen repacking, leave out resources of <type>.\n\t\t\t\tMay be given more than once.\n");
+	printf("\t--dedup\t\t\tWhen repacking, store identical resource data\n\t\t\t\tonly once.\n");
+	printf("\t--sync\t\t\tFlush each output file to disk before giving\n\t\t\t\tit its name.\n");
+	printf("\t--stats\t\t\tPrint how many resource buffers were allocated\n\t\t\t\tversus reused.\n");
+	printf("\t--catalog <name>\tWhen indexing, the catalog file to write in\n\t\t\t\tthe output directory (default macresview.cat).\n");
+	printf("\t--type <type>\t\tWhen querying, match resources of <type>.\n");
+	printf("\t--id <id>\t\tWhen querying, match resources with <id>.\n");
+	printf("\t--name <name>\t\tWhen querying, match resources named <name>,\n\t\t\t\tignoring case.\n");
+	printf("\t--chain <file>\t\tList, dump or convert the file together with\n\t\t\t\t<file>, as one resource chain; resources in\n\t\t\t\tthe main file win, then each --chain file in\n\t\t\t\torder. May be given more than once.\n");
+	printf("\t--then <mode>\t\tWhen watching, run 'list' (default), 'dump',\n\t\t\t\tor 'convert' on each new file.\n");
+	printf("\t--settle <ms>\t\tWhen watching, wait this long after a file's\n\t\t\t\tlast event before processing it (default 200).\n");
+	printf("\t--alias <from>=<to>\tWhen converting, treat resources of type\n\t\t\t\t<from> like type <to>.\n");
+	printf("\t--hex <bytes>\t\tWhen grepping, search for these hex bytes.\n\t\t\t\tMay be given more than once.\n");
+	printf("\t--string <text>\t\tWhen grepping, search for this text. May be\n\t\t\t\tgiven more than once.\n");
+	printf("\t--macroman\t\tWhen grepping, encode --string text as\n\t\t\t\tMacRoman first.\n");
 }
 
 #define MACRESVIEW_VERSION "0.0.1"
 
-int main(int argc, const char **argv) {
+void printBanner() {
 	printf("\nmacresview " MACRESVIEW_VERSION " - Mac Resource Fork Viewer\n");
 	printf("Examines Mac resource forks and extracts/converts certain resources\n");
 	printf("Written by Matthew Hoops (clone2727)\n");
 	printf("Based on ScummVM code\n");
 	printf("See COPYING for the license\n\n");
+}
 
+int main(int argc, const char **argv) {
 	if (argc < 3) {
+		printBanner();
 		printUsage(argv[0]);
 		return 0;
 	}
@@ -371,12 +1314,83 @@ int main(int argc, const char **argv) {
 	if (options.mode == kRunModeUnk)
 		return -1;
 
-	ResourceFork resFork;
-	if (!resFork.load(options.inputName)) {
-		printf("Failed to open file '%s'\n", options.inputName);
+	// Keep machine-readable output clean
+	if (options.mode == kRunModeDiff) {
+		if (!options.baseInputName) {
+			fprintf(stderr, "diff needs two file names\n");
+			return -1;
+		}
+
+		if (!options.jsonl)
+			printBanner();
+
+		return doDiff(options) ? 0 : -1;
+	}
+
+	// Keep machine-readable output clean here too
+	if (!options.jsonl)
+		printBanner();
+
+	if (options.mode == kRunModeGrep) {
+		if (options.inputNames.empty()) {
+			printf("grep needs at least one file name\n");
+			return -1;
+		}
+
+		return doGrep(options) ? 0 : -1;
+	}
+
+	if (options.mode == kRunModeQuery)
+		return doQuery(options) ? 0 : -1;
+
+	OutputDirectory outputDir;
+	if (!outputDir.open(options.outputDirName, options.shardFlags)) {
+		printf("Failed to open output directory '%s'\n", options.outputDirName);
 		return -1;
 	}
 
-	doMode(resFork, options);
+	outputDir.setSync(options.sync);
+
+	if (options.mode == kRunModeScan) {
+		doScan(options, outputDir);
+		return 0;
+	}
+
+	if (options.mode == kRunModeIndex)
+		return doIndex(options, outputDir) ? 0 : -1;
+
+	if (options.mode == kRunModeWatch)
+		return doWatch(options, outputDir) ? 0 : -1;
+
+	ResourceFork resFork;
+	if (!options.chainNames.empty()) {
+		if (!doChain(options, outputDir))
+			return -1;
+	} else if (options.mode == kRunModeRepack) {
+		if (!resFork.load(options.inputName)) {
+			printf("Failed to open file '%s'\n", options.inputName);
+			return -1;
+		}
+
+		return doRepack(resFork, options, outputDir) ? 0 : -1;
+	} else if (resFork.load(options.inputName)) {
+		doMode(resFork, options, outputDir, "");
+	} else {
+		// Not a resource fork, but maybe a whole disk image
+		HFSVolume volume;
+		if (!volume.open(options.inputName)) {
+			printf("Failed to open file '%s'\n", options.inputName);
+			return -1;
+		}
+
+		doVolume(volume, options, outputDir);
+	}
+
+	if (options.showStats)
+		printf("\nResource buffers: %llu allocated, %llu reused\n", (unsigned long long)BufferPool::getAllocationCount(), (unsigned long long)BufferPool::getReuseCount());
+
+	if (!options.jsonl)
+		printf("\nAll done!\n");
+
 	return 0;
 }
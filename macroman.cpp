@@ -0,0 +1,176 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "macroman.h"
+#include "util.h"
+
+// Unicode code points for MacRoman 0x80-0xFF
+static const uint16 s_macRomanHigh[128] = {
+	0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1,
+	0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+	0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3,
+	0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+	0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF,
+	0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+	0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211,
+	0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+	0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB,
+	0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+	0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA,
+	0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+	0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1,
+	0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+	0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC,
+	0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7
+};
+
+static void appendCodePoint(std::string &result, byte c) {
+	uint16 codePoint = s_macRomanHigh[c - 0x80];
+
+	if (codePoint < 0x800) {
+		result += (char)(0xC0 | (codePoint >> 6));
+		result += (char)(0x80 | (codePoint & 0x3F));
+	} else {
+		result += (char)(0xE0 | (codePoint >> 12));
+		result += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		result += (char)(0x80 | (codePoint & 0x3F));
+	}
+}
+
+// How many bytes from the start can be copied straight across: plain ASCII,
+// and no CRs if those are being turned into LFs
+static uint32 findASCIIRun(const byte *data, uint32 length, bool convertLineEndings) {
+	uint32 i = 0;
+
+#ifdef __SSE2__
+	const __m128i cr = _mm_set1_epi8('\r');
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+		int mask = _mm_movemask_epi8(block);
+
+		if (convertLineEndings)
+			mask |= _mm_movemask_epi8(_mm_cmpeq_epi8(block, cr));
+
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+
+	for (; i < length; i++)
+		if (data[i] >= 0x80 || (convertLineEndings && data[i] == '\r'))
+			break;
+
+	return i;
+}
+
+void appendMacRomanAsUTF8(const byte *data, uint32 length, std::string &result, bool convertLineEndings) {
+	result.reserve(result.size() + length);
+
+	while (length > 0) {
+		uint32 run = findASCIIRun(data, length, convertLineEndings);
+		result.append((const char *)data, run);
+		data += run;
+		length -= run;
+
+		if (length == 0)
+			break;
+
+		if (*data == '\r')
+			result += '\n';
+		else
+			appendCodePoint(result, *data);
+
+		data++;
+		length--;
+	}
+}
+
+std::string convertMacRomanToUTF8(const std::string &str) {
+	std::string result;
+	appendMacRomanAsUTF8((const byte *)str.c_str(), str.size(), result, false);
+	return result;
+}
+
+bool convertUTF8ToMacRoman(const std::string &str, std::string &result) {
+	result.clear();
+
+	for (uint32 i = 0; i < str.size();) {
+		byte c = str[i++];
+		uint32 codePoint, extraBytes;
+
+		if (c < 0x80) {
+			result += (char)c;
+			continue;
+		} else if ((c & 0xE0) == 0xC0) {
+			codePoint = c & 0x1F;
+			extraBytes = 1;
+		} else if ((c & 0xF0) == 0xE0) {
+			codePoint = c & 0x0F;
+			extraBytes = 2;
+		} else {
+			return false; // Nothing MacRoman has lives past the BMP
+		}
+
+		for (; extraBytes > 0; extraBytes--) {
+			if (i >= str.size() || (str[i] & 0xC0) != 0x80)
+				return false;
+
+			codePoint = (codePoint << 6) | (str[i++] & 0x3F);
+		}
+
+		uint32 j = 0;
+		while (j < 128 && s_macRomanHigh[j] != codePoint)
+			j++;
+
+		if (j == 128)
+			return false;
+
+		result += (char)(j + 0x80);
+	}
+
+	return true;
+}
+
+bool parsePascalStrings(const byte *data, uint32 length, uint32 count, std::vector<std::string> &strings) {
+	for (uint32 i = 0; i < count; i++) {
+		if (length == 0 || data[0] >= length)
+			return false;
+
+		std::string str;
+		appendMacRomanAsUTF8(data + 1, data[0], str, true);
+		strings.push_back(str);
+
+		length -= data[0] + 1;
+		data += data[0] + 1;
+	}
+
+	return true;
+}
+
+bool parseStringList(const byte *data, uint32 length, std::vector<std::string> &strings) {
+	return length >= 2 && parsePascalStrings(data + 2, length - 2, READ_UINT16_BE(data), strings);
+}
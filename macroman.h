@@ -0,0 +1,47 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef MACROMAN_H
+#define MACROMAN_H
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+// Resource names and text are generally in MacRoman
+std::string convertMacRomanToUTF8(const std::string &str);
+
+// Append MacRoman text to result as UTF-8, optionally turning the Mac's CR
+// line endings into LFs. Runs of plain ASCII are copied 16 bytes at a time.
+void appendMacRomanAsUTF8(const byte *data, uint32 length, std::string &result, bool convertLineEndings);
+
+// Fails if str is not valid UTF-8 or has characters MacRoman lacks
+bool convertUTF8ToMacRoman(const std::string &str, std::string &result);
+
+// Read count Pascal strings packed one after another, as in 'STR ', as
+// UTF-8. Fails if any of them runs past the end of the data.
+bool parsePascalStrings(const byte *data, uint32 length, uint32 count, std::vector<std::string> &strings);
+
+// A 'STR#' list: a 16-bit count followed by that many Pascal strings
+bool parseStringList(const byte *data, uint32 length, std::vector<std::string> &strings);
+
+#endif
@@ -0,0 +1,230 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "output.h"
+#include "util.h"
+
+OutputDirectory::OutputDirectory() {
+	_fd = -1;
+	_shardFlags = kShardNone;
+	_sync = false;
+}
+
+OutputDirectory::~OutputDirectory() {
+	close();
+}
+
+bool OutputDirectory::open(const std::string &path, uint32 shardFlags) {
+	_shardFlags = shardFlags;
+
+	// Create the directory (and its parents) first if need be
+	for (uint32 i = 1; i <= path.size(); i++)
+		if (i == path.size() || path[i] == '/')
+			mkdir(path.substr(0, i).c_str(), 0777);
+
+	_fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+	return _fd >= 0;
+}
+
+void OutputDirectory::close() {
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+
+	_createdDirectories.clear();
+}
+
+std::string OutputDirectory::getPath(const std::string &prefix, uint32 tag, uint16 id, const std::string &fileName) const {
+	std::string path = prefix;
+
+	if (_shardFlags & kShardByType) {
+		for (int i = 24; i >= 0; i -= 8) {
+			char c = (tag >> i) & 0xff;
+
+			// Keep the folder name sane for the few odd FourCCs
+			if (c == '/' || c == '.' || (byte)c < 0x20)
+				c = '_';
+
+			path += c;
+		}
+
+		path += '/';
+	}
+
+	if (_shardFlags & kShardByID) {
+		char idPrefix[4];
+		sprintf(idPrefix, "%02x/", id >> 8);
+		path += idPrefix;
+	}
+
+	// Resource names come straight from the fork and may contain '/' or be
+	// "..", so they mustn't be able to step out of the output directory
+	return path + sanitizeName(fileName);
+}
+
+bool OutputDirectory::createParentDirectories(const std::string &path) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (uint32 i = 1; i < path.size(); i++) {
+		if (path[i] != '/')
+			continue;
+
+		std::string directory = path.substr(0, i);
+		if (_createdDirectories.count(directory))
+			continue;
+
+		if (mkdirat(_fd, directory.c_str(), 0777) != 0 && errno != EEXIST)
+			return false;
+
+		_createdDirectories.insert(directory);
+	}
+
+	return true;
+}
+
+OutputFile::OutputFile() {
+	_directory = 0;
+	_file = 0;
+}
+
+OutputFile::~OutputFile() {
+	discard();
+}
+
+static std::string getParentPath(const std::string &path) {
+	size_t separator = path.rfind('/');
+	return (separator == std::string::npos) ? "." : path.substr(0, separator);
+}
+
+// A hidden, unique name in the same folder as path
+static std::string getTempPath(const std::string &path) {
+	static std::atomic<uint32> tempCounter(0);
+
+	char suffix[32];
+	sprintf(suffix, ".%d.%u.tmp", (int)getpid(), (uint)tempCounter++);
+
+	size_t separator = path.rfind('/');
+	if (separator == std::string::npos)
+		return "." + path + suffix;
+
+	return path.substr(0, separator + 1) + "." + path.substr(separator + 1) + suffix;
+}
+
+bool OutputFile::open(OutputDirectory &directory, const std::string &path) {
+	if (path.empty() || !directory.createParentDirectories(path))
+		return false;
+
+	_directory = &directory;
+	_path = path;
+	_tempPath.clear();
+
+	int fd = -1;
+
+#ifdef O_TMPFILE
+	// An anonymous file has no name at all until it gets linked in
+	fd = openat(directory.getFD(), getParentPath(path).c_str(), O_TMPFILE | O_WRONLY, 0666);
+#endif
+
+	// Otherwise fall back to a hidden temporary name next to the target
+	if (fd < 0) {
+		_tempPath = getTempPath(path);
+		fd = openat(directory.getFD(), _tempPath.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0666);
+	}
+
+	if (fd < 0)
+		return false;
+
+	_file = fdopen(fd, "wb");
+
+	if (!_file) {
+		::close(fd);
+		discard();
+		return false;
+	}
+
+	return true;
+}
+
+bool OutputFile::commit() {
+	if (!_file)
+		return false;
+
+	bool success = fflush(_file) == 0 && !ferror(_file);
+
+	// If asked, make sure the contents are on disk before the name points at
+	// them, so a crash can't leave an empty or partial file under the real
+	// name. This costs a disk flush per file, so it's off by default.
+	if (success && _directory->getSync())
+		success = fsync(fileno(_file)) == 0;
+	int dirFD = _directory->getFD();
+
+	if (success && _tempPath.empty()) {
+		char procPath[64];
+		sprintf(procPath, "/proc/self/fd/%d", fileno(_file));
+
+		// linkat() won't replace an existing file, so in that case go
+		// through a temporary name and rename it over the old one
+		if (linkat(AT_FDCWD, procPath, dirFD, _path.c_str(), AT_SYMLINK_FOLLOW) != 0) {
+			if (errno == EEXIST) {
+				std::string tempPath = getTempPath(_path);
+				success = linkat(AT_FDCWD, procPath, dirFD, tempPath.c_str(), AT_SYMLINK_FOLLOW) == 0;
+
+				if (success && renameat(dirFD, tempPath.c_str(), dirFD, _path.c_str()) != 0) {
+					unlinkat(dirFD, tempPath.c_str(), 0);
+					success = false;
+				}
+			} else {
+				success = false;
+			}
+		}
+	} else if (success) {
+		success = renameat(dirFD, _tempPath.c_str(), dirFD, _path.c_str()) == 0;
+	}
+
+	fclose(_file);
+	_file = 0;
+
+	if (!success)
+		discard();
+
+	_tempPath.clear();
+	return success;
+}
+
+void OutputFile::discard() {
+	if (_file) {
+		fclose(_file);
+		_file = 0;
+	}
+
+	if (!_tempPath.empty()) {
+		unlinkat(_directory->getFD(), _tempPath.c_str(), 0);
+		_tempPath.clear();
+	}
+}
@@ -0,0 +1,87 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <string>
+#include "types.h"
+
+enum {
+	kShardNone = 0,
+	kShardByType = 1 << 0, // One folder per FourCC
+	kShardByID = 1 << 1    // One folder per high byte of the ID
+};
+
+// The directory all output goes into. Everything is created relative to
+// an open descriptor of it, so paths never get looked up from the CWD.
+class OutputDirectory {
+public:
+	OutputDirectory();
+	~OutputDirectory();
+
+	bool open(const std::string &path, uint32 shardFlags);
+	void close();
+	int getFD() const { return _fd; }
+
+	// Whether committed files are synced to disk before they get their name
+	void setSync(bool sync) { _sync = sync; }
+	bool getSync() const { return _sync; }
+
+	// Build the path (relative to the directory) for a resource's output
+	std::string getPath(const std::string &prefix, uint32 tag, uint16 id, const std::string &fileName) const;
+
+	// Create any missing folders leading up to a relative path
+	bool createParentDirectories(const std::string &path);
+
+private:
+	int _fd;
+	uint32 _shardFlags;
+	bool _sync;
+
+	std::mutex _mutex;
+	std::set<std::string> _createdDirectories;
+};
+
+// A file that only shows up under its name once it has been completely
+// written and committed. Anything not committed is thrown away.
+class OutputFile {
+public:
+	OutputFile();
+	~OutputFile();
+
+	bool open(OutputDirectory &directory, const std::string &path);
+	FILE *getFile() const { return _file; }
+	bool commit();
+	void discard();
+
+private:
+	OutputDirectory *_directory;
+	std::string _path;
+	std::string _tempPath; // Empty when using an anonymous (O_TMPFILE) file
+	FILE *_file;
+};
+
+#endif
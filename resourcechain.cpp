@@ -0,0 +1,157 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <ctype.h>
+
+#include "resourcechain.h"
+
+ResourceChain::ResourceChain() {
+}
+
+ResourceChain::~ResourceChain() {
+	close();
+}
+
+bool ResourceChain::addFork(const char *filename) {
+	ResourceFork *resFork = new ResourceFork();
+
+	if (!resFork->load(filename)) {
+		delete resFork;
+		return false;
+	}
+
+	addFork(resFork, filename);
+	return true;
+}
+
+void ResourceChain::addFork(ResourceFork *resFork, const std::string &name) {
+	uint32 forkIndex = _forks.size();
+	_forks.push_back(resFork);
+	_forkNames.push_back(name);
+
+	// map::insert leaves existing keys alone, which is exactly "first wins"
+	const std::vector<ResourceForkType> &types = resFork->getTypes();
+
+	for (uint32 i = 0; i < types.size(); i++) {
+		for (uint32 j = 0; j < types[i].ids.size(); j++) {
+			const ResourceForkID &id = types[i].ids[j];
+			_forkByResource.insert(std::make_pair(ResourceKey(types[i].tag, id.id), forkIndex));
+
+			if (id.filename.empty())
+				continue;
+
+			// A name can still find a resource whose ID is overridden, as
+			// with GetNamedResource()
+			NamedResource named;
+			named.forkIndex = forkIndex;
+			named.tag = types[i].tag;
+			named.id = id.id;
+
+			std::string name = foldName(id.filename);
+			_resourceByName.insert(std::make_pair(name, named));
+			_resourceByTagAndName.insert(std::make_pair(std::make_pair(types[i].tag, name), named));
+		}
+	}
+}
+
+void ResourceChain::close() {
+	for (uint32 i = 0; i < _forks.size(); i++)
+		delete _forks[i];
+
+	_forks.clear();
+	_forkNames.clear();
+	_forkByResource.clear();
+	_resourceByName.clear();
+	_resourceByTagAndName.clear();
+}
+
+std::string ResourceChain::foldName(const std::string &name) {
+	std::string folded = name;
+
+	for (uint32 i = 0; i < folded.size(); i++)
+		folded[i] = tolower((byte)folded[i]);
+
+	return folded;
+}
+
+ResourceFork *ResourceChain::findFork(uint32 tag, uint16 id) const {
+	std::map<ResourceKey, uint32>::const_iterator it = _forkByResource.find(ResourceKey(tag, id));
+	return (it == _forkByResource.end()) ? 0 : _forks[it->second];
+}
+
+DataPair ResourceChain::getResource(uint32 tag, uint16 id) {
+	ResourceFork *resFork = findFork(tag, id);
+	return resFork ? resFork->getResource(tag, id) : DataPair();
+}
+
+DataPair ResourceChain::getResource(const std::string &filename) {
+	std::map<std::string, NamedResource>::const_iterator it = _resourceByName.find(foldName(filename));
+
+	if (it == _resourceByName.end())
+		return DataPair();
+
+	return _forks[it->second.forkIndex]->getResource(it->second.tag, it->second.id);
+}
+
+DataPair ResourceChain::getResource(uint32 tag, const std::string &filename) {
+	std::map<std::pair<uint32, std::string>, NamedResource>::const_iterator it = _resourceByTagAndName.find(std::make_pair(tag, foldName(filename)));
+
+	if (it == _resourceByTagAndName.end())
+		return DataPair();
+
+	return _forks[it->second.forkIndex]->getResource(it->second.tag, it->second.id);
+}
+
+uint32 ResourceChain::getResourceSize(uint32 tag, uint16 id) {
+	ResourceFork *resFork = findFork(tag, id);
+	return resFork ? resFork->getResourceSize(tag, id) : 0;
+}
+
+bool ResourceChain::writeResource(uint32 tag, uint16 id, FILE *output) {
+	ResourceFork *resFork = findFork(tag, id);
+	return resFork && resFork->writeResource(tag, id, output);
+}
+
+std::string ResourceChain::getFilename(uint32 tag, uint16 id) {
+	ResourceFork *resFork = findFork(tag, id);
+	return resFork ? resFork->getFilename(tag, id) : std::string();
+}
+
+std::vector<uint32> ResourceChain::getTagArray() const {
+	std::vector<uint32> tagArray;
+
+	for (std::map<ResourceKey, uint32>::const_iterator it = _forkByResource.begin(); it != _forkByResource.end(); it++)
+		if (tagArray.empty() || tagArray.back() != it->first.first)
+			tagArray.push_back(it->first.first);
+
+	return tagArray;
+}
+
+std::vector<uint16> ResourceChain::getIDArray(uint32 tag) const {
+	std::vector<uint16> idArray;
+
+	std::map<ResourceKey, uint32>::const_iterator it = _forkByResource.lower_bound(ResourceKey(tag, 0));
+	for (; it != _forkByResource.end() && it->first.first == tag; it++)
+		idArray.push_back(it->first.second);
+
+	return idArray;
+}
@@ -0,0 +1,86 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef RESOURCECHAIN_H
+#define RESOURCECHAIN_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "macresfork.h"
+
+// Several forks looked at as one, like the Resource Manager's chain of
+// open resource files: where two forks define the same resource, the one
+// added first wins. One merged index answers every lookup, so finding a
+// resource never means asking each fork in turn.
+class ResourceChain {
+public:
+	ResourceChain();
+	~ResourceChain();
+
+	// The chain owns its forks, so copies would delete them twice
+	ResourceChain(const ResourceChain &) = delete;
+	ResourceChain &operator=(const ResourceChain &) = delete;
+
+	bool addFork(const char *filename);
+	void addFork(ResourceFork *resFork, const std::string &name); // Takes ownership
+	void close();
+
+	uint32 getForkCount() const { return _forks.size(); }
+	ResourceFork *getFork(uint32 index) const { return _forks[index]; }
+	const std::string &getForkName(uint32 index) const { return _forkNames[index]; }
+
+	// The fork a resource will be served from, or 0 if there is none
+	ResourceFork *findFork(uint32 tag, uint16 id) const;
+
+	DataPair getResource(uint32 tag, uint16 id);
+	DataPair getResource(const std::string &filename);              // Ignoring case
+	DataPair getResource(uint32 tag, const std::string &filename); // Ditto
+
+	uint32 getResourceSize(uint32 tag, uint16 id);
+	bool writeResource(uint32 tag, uint16 id, FILE *output);
+	std::string getFilename(uint32 tag, uint16 id);
+
+	// The merged view, with overridden resources left out
+	std::vector<uint32> getTagArray() const;
+	std::vector<uint16> getIDArray(uint32 tag) const;
+
+private:
+	typedef std::pair<uint32, uint16> ResourceKey;
+
+	struct NamedResource {
+		uint32 forkIndex;
+		uint32 tag;
+		uint16 id;
+	};
+
+	static std::string foldName(const std::string &name);
+
+	std::vector<ResourceFork *> _forks;
+	std::vector<std::string> _forkNames;
+	std::map<ResourceKey, uint32> _forkByResource; // Sorted by tag, then ID
+	std::map<std::string, NamedResource> _resourceByName;
+	std::map<std::pair<uint32, std::string>, NamedResource> _resourceByTagAndName;
+};
+
+#endif
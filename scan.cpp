@@ -0,0 +1,132 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "macresfork.h"
+#include "scan.h"
+
+// Resource forks inside images always start on at least a 16 byte boundary
+// (HFS allocation blocks are multiples of 512, MacBinary pads to 128).
+#define SCAN_ALIGNMENT 16
+#define SCAN_BUFFER_SIZE (1024 * 1024)
+
+// The Resource Manager always writes a data offset of 256 and the map is
+// addressed with 16-bit offsets, so set high bytes in either mean junk.
+static inline bool isCandidateHeader(const byte *header) {
+	return (header[0] | header[1] | header[12]) == 0;
+}
+
+struct ScanJob {
+	const char *filename;
+	uint64 start;
+	uint64 end;
+	std::vector<ForkLocation> forks;
+};
+
+static void scanRange(ScanJob *job) {
+	FILE *file = fopen(job->filename, "rb");
+
+	if (!file)
+		return;
+
+	uint64 fileSize = getFileSize(file);
+	byte *buffer = new byte[SCAN_BUFFER_SIZE];
+	uint64 pos = job->start;
+
+	seekFile(file, pos);
+
+	while (pos < job->end) {
+		uint32 toRead = SCAN_BUFFER_SIZE;
+		if (job->end - pos < toRead)
+			toRead = job->end - pos;
+
+		uint32 bytesRead = fread(buffer, 1, toRead, file);
+
+		for (uint32 i = 0; i + 16 <= bytesRead; i += SCAN_ALIGNMENT) {
+			if (!isCandidateHeader(buffer + i) || !ResourceFork::isValidHeader(buffer + i, pos + i, fileSize))
+				continue;
+
+			// Passed the cheap checks, now have the real loader validate the map
+			ResourceFork resFork;
+			if (!resFork.loadAtOffset(job->filename, pos + i))
+				continue;
+
+			ForkLocation location;
+			location.offset = pos + i;
+			location.size = resFork.getForkSize();
+			location.typeCount = resFork.getTypeCount();
+			job->forks.push_back(location);
+		}
+
+		if (bytesRead != toRead)
+			break;
+
+		pos += bytesRead;
+	}
+
+	delete[] buffer;
+	fclose(file);
+}
+
+static bool compareForkLocation(const ForkLocation &a, const ForkLocation &b) {
+	return a.offset < b.offset;
+}
+
+std::vector<ForkLocation> scanForResourceForks(const char *filename, uint jobCount) {
+	std::vector<ForkLocation> forks;
+
+	FILE *file = fopen(filename, "rb");
+	if (!file)
+		return forks;
+
+	uint64 fileSize = getFileSize(file);
+	fclose(file);
+
+	if (jobCount == 0)
+		jobCount = 1;
+
+	// Don't bother splitting into chunks smaller than the read buffer
+	while (jobCount > 1 && fileSize / jobCount < SCAN_BUFFER_SIZE)
+		jobCount--;
+
+	uint64 chunkSize = (fileSize / jobCount + SCAN_ALIGNMENT - 1) & ~(uint64)(SCAN_ALIGNMENT - 1);
+
+	std::vector<ScanJob> jobs(jobCount);
+	std::vector<std::thread> threads;
+
+	for (uint i = 0; i < jobCount; i++) {
+		jobs[i].filename = filename;
+		jobs[i].start = chunkSize * i;
+		jobs[i].end = (i == jobCount - 1) ? fileSize : std::min(chunkSize * (i + 1), fileSize);
+		threads.push_back(std::thread(scanRange, &jobs[i]));
+	}
+
+	for (uint i = 0; i < jobCount; i++) {
+		threads[i].join();
+		forks.insert(forks.end(), jobs[i].forks.begin(), jobs[i].forks.end());
+	}
+
+	std::sort(forks.begin(), forks.end(), compareForkLocation);
+	return forks;
+}
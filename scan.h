@@ -0,0 +1,40 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <vector>
+#include "types.h"
+
+// Location of a resource fork found while carving a disk/CD image
+struct ForkLocation {
+	uint64 offset;
+	uint64 size;
+	uint32 typeCount;
+};
+
+// Sweep a (potentially huge) file for embedded resource forks, splitting
+// the file into jobCount chunks that are scanned in parallel.
+std::vector<ForkLocation> scanForResourceForks(const char *filename, uint jobCount);
+
+#endif
@@ -0,0 +1,169 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "stream.h"
+#include "util.h"
+
+byte SeekableReadStream::readByte() {
+	byte b = 0;
+	read(&b, 1);
+	return b;
+}
+
+uint16 SeekableReadStream::readUint16BE() {
+	byte data[2] = { 0, 0 };
+	read(data, 2);
+	return READ_UINT16_BE(data);
+}
+
+uint32 SeekableReadStream::readUint32BE() {
+	byte data[4] = { 0, 0, 0, 0 };
+	read(data, 4);
+	return READ_UINT32_BE(data);
+}
+
+FileReadStream::FileReadStream(FILE *file, bool disposeAfterUse) {
+	_file = file;
+	_disposeAfterUse = disposeAfterUse;
+	_size = getFileSize(file);
+}
+
+FileReadStream::~FileReadStream() {
+	if (_disposeAfterUse)
+		fclose(_file);
+}
+
+uint32 FileReadStream::read(void *dst, uint32 size) {
+	uint32 bytesRead = fread(dst, 1, size, _file);
+
+	if (bytesRead != size)
+		_eos = true;
+
+	return bytesRead;
+}
+
+bool FileReadStream::seek(uint64 offset) {
+	_eos = false;
+	return seekFile(_file, offset);
+}
+
+uint64 FileReadStream::pos() const {
+	return tellFile(_file);
+}
+
+uint64 FileReadStream::size() const {
+	return _size;
+}
+
+MemoryReadStream::MemoryReadStream(byte *data, uint64 size, bool disposeAfterUse) {
+	_data = data;
+	_size = size;
+	_disposeAfterUse = disposeAfterUse;
+	_pos = 0;
+}
+
+MemoryReadStream::~MemoryReadStream() {
+	if (_disposeAfterUse)
+		delete[] _data;
+}
+
+uint32 MemoryReadStream::read(void *dst, uint32 size) {
+	if (size > _size - _pos) {
+		size = _size - _pos;
+		_eos = true;
+	}
+
+	memcpy(dst, _data + _pos, size);
+	_pos += size;
+	return size;
+}
+
+bool MemoryReadStream::seek(uint64 offset) {
+	_eos = false;
+
+	if (offset > _size)
+		return false;
+
+	_pos = offset;
+	return true;
+}
+
+ExtentReadStream::ExtentReadStream(FILE *file, const std::vector<Extent> &extents, bool disposeAfterUse) : _extents(extents) {
+	_file = file;
+	_disposeAfterUse = disposeAfterUse;
+	_pos = 0;
+	_size = 0;
+
+	for (uint32 i = 0; i < _extents.size(); i++)
+		_size += _extents[i].length;
+}
+
+ExtentReadStream::~ExtentReadStream() {
+	if (_disposeAfterUse)
+		fclose(_file);
+}
+
+uint32 ExtentReadStream::read(void *dst, uint32 size) {
+	byte *ptr = (byte *)dst;
+	uint32 bytesRead = 0;
+
+	// Find the extent containing the current position
+	uint64 extentStart = 0;
+	uint32 i = 0;
+	while (i < _extents.size() && extentStart + _extents[i].length <= _pos)
+		extentStart += _extents[i++].length;
+
+	while (bytesRead < size && i < _extents.size()) {
+		uint64 offsetInExtent = _pos - extentStart;
+		uint64 chunkSize = _extents[i].length - offsetInExtent;
+
+		if (chunkSize > size - bytesRead)
+			chunkSize = size - bytesRead;
+
+		seekFile(_file, _extents[i].offset + offsetInExtent);
+		uint32 chunkRead = fread(ptr + bytesRead, 1, chunkSize, _file);
+		bytesRead += chunkRead;
+		_pos += chunkRead;
+
+		if (chunkRead != chunkSize)
+			break;
+
+		extentStart += _extents[i++].length;
+	}
+
+	if (bytesRead != size)
+		_eos = true;
+
+	return bytesRead;
+}
+
+bool ExtentReadStream::seek(uint64 offset) {
+	_eos = false;
+
+	if (offset > _size)
+		return false;
+
+	_pos = offset;
+	return true;
+}
@@ -0,0 +1,116 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+#include <vector>
+#include "types.h"
+
+// A simple seekable read stream, loosely modeled after ScummVM's
+class SeekableReadStream {
+public:
+	SeekableReadStream() { _eos = false; }
+	virtual ~SeekableReadStream() {}
+
+	virtual uint32 read(void *dst, uint32 size) = 0;
+	virtual bool seek(uint64 offset) = 0;
+	virtual uint64 pos() const = 0;
+	virtual uint64 size() const = 0;
+
+	// Set once a read has come up short
+	bool eos() const { return _eos; }
+
+	byte readByte();
+	uint16 readUint16BE();
+	uint32 readUint32BE();
+
+protected:
+	bool _eos;
+};
+
+// Wraps a stdio file
+class FileReadStream : public SeekableReadStream {
+public:
+	FileReadStream(FILE *file, bool disposeAfterUse = true);
+	~FileReadStream();
+
+	uint32 read(void *dst, uint32 size);
+	bool seek(uint64 offset);
+	uint64 pos() const;
+	uint64 size() const;
+
+private:
+	FILE *_file;
+	bool _disposeAfterUse;
+	uint64 _size;
+};
+
+// A stream over a buffer in memory
+class MemoryReadStream : public SeekableReadStream {
+public:
+	MemoryReadStream(byte *data, uint64 size, bool disposeAfterUse = true);
+	~MemoryReadStream();
+
+	uint32 read(void *dst, uint32 size);
+	bool seek(uint64 offset);
+	uint64 pos() const { return _pos; }
+	uint64 size() const { return _size; }
+
+private:
+	byte *_data;
+	bool _disposeAfterUse;
+	uint64 _pos;
+	uint64 _size;
+};
+
+// A run of bytes in a file
+struct Extent {
+	Extent() { offset = length = 0; }
+	Extent(uint64 o, uint64 l) { offset = o; length = l; }
+
+	uint64 offset;
+	uint64 length;
+};
+
+// Presents a list of extents scattered through a file (e.g. a fork on a
+// disk image) as one contiguous stream, without copying anything out.
+class ExtentReadStream : public SeekableReadStream {
+public:
+	ExtentReadStream(FILE *file, const std::vector<Extent> &extents, bool disposeAfterUse = false);
+	~ExtentReadStream();
+
+	uint32 read(void *dst, uint32 size);
+	bool seek(uint64 offset);
+	uint64 pos() const { return _pos; }
+	uint64 size() const { return _size; }
+
+private:
+	FILE *_file;
+	bool _disposeAfterUse;
+	std::vector<Extent> _extents;
+	uint64 _pos;
+	uint64 _size;
+};
+
+#endif
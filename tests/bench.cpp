@@ -0,0 +1,313 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+// Rough throughput numbers for the hot paths, for comparing before and
+// after a change on the same machine. 'make bench' builds and runs it.
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../bufferpool.h"
+#include "../dcmp.h"
+#include "../macresfork.h"
+#include "../util.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// A 'dcmp' (0) resource mixing the common codes, roughly as 68k code
+// compresses: literals, back references to them, table words and runs
+static std::vector<byte> makeDcmp0Resource(uint32 &decompressedSize) {
+	std::vector<byte> data;
+	decompressedSize = 0;
+
+	for (uint32 i = 0; i < 0x28 + 0x100; i++) {
+		// A stored literal of three words...
+		byte literal[] = { 0x13, 0x4E, 0x56, (byte)i, (byte)(i >> 8), 0x2F, 0x0A };
+		data.insert(data.end(), literal, literal + sizeof(literal));
+		decompressedSize += 6;
+
+		// ...a few table words...
+		for (byte code = 0x4B; code < 0x53; code++)
+			data.push_back(code);
+		decompressedSize += 16;
+
+		// ...a reference to an earlier literal...
+		if (i >= 0x28) {
+			data.push_back(0x20);
+			data.push_back((byte)(i - 0x28));
+		} else {
+			data.push_back(0x23 + i);
+		}
+		decompressedSize += 6;
+
+		// ...and a short run of zeros
+		byte run[] = { 0xFE, 0x02, 0x40, 0x4F };
+		data.insert(data.end(), run, run + sizeof(run));
+		decompressedSize += 16;
+	}
+
+	data.push_back(0xFF);
+
+	std::vector<byte> resource(18);
+	WRITE_UINT32_BE(&resource[0], 0xA89F6572);
+	WRITE_UINT16_BE(&resource[4], 18);
+	resource[6] = 8;
+	resource[7] = 1;
+	WRITE_UINT32_BE(&resource[8], decompressedSize);
+	resource.insert(resource.end(), data.begin(), data.end());
+	return resource;
+}
+
+// The same mix for 'dcmp' (1), whose codes are byte oriented
+static std::vector<byte> makeDcmp1Resource(uint32 &decompressedSize) {
+	std::vector<byte> data;
+	decompressedSize = 0;
+
+	for (uint32 i = 0; i < 0x1B0; i++) {
+		// A stored literal of six bytes...
+		byte literal[] = { 0x15, 0x4E, 0x56, (byte)i, (byte)(i >> 8), 0x2F, 0x0A };
+		data.insert(data.end(), literal, literal + sizeof(literal));
+		decompressedSize += 6;
+
+		// ...a few table words...
+		for (byte code = 0xD5; code < 0xDD; code++)
+			data.push_back(code);
+		decompressedSize += 16;
+
+		// ...a reference to that literal...
+		if (i < 0xB0) {
+			data.push_back(0x20 + i);
+		} else {
+			data.push_back(0xD2);
+			data.push_back((byte)(i - 0xB0));
+		}
+		decompressedSize += 6;
+
+		// ...and a short run of zeros
+		byte run[] = { 0xFE, 0x02, 0x40, 0x4F };
+		data.insert(data.end(), run, run + sizeof(run));
+		decompressedSize += 16;
+	}
+
+	data.push_back(0xFF);
+
+	std::vector<byte> resource(18);
+	WRITE_UINT32_BE(&resource[0], 0xA89F6572);
+	WRITE_UINT16_BE(&resource[4], 18);
+	resource[6] = 8;
+	resource[7] = 1;
+	WRITE_UINT32_BE(&resource[8], decompressedSize);
+	WRITE_UINT16_BE(&resource[14], 1);
+	resource.insert(resource.end(), data.begin(), data.end());
+	return resource;
+}
+
+// 'dcmp' (2) with the default table and tag bytes: half the words come
+// from the table and half are literal
+static std::vector<byte> makeDcmp2Resource(uint32 &decompressedSize) {
+	std::vector<byte> data;
+	decompressedSize = 0;
+
+	for (uint32 i = 0; i < 1024; i++) {
+		data.push_back(0xF0);
+
+		for (uint32 j = 0; j < 4; j++)
+			data.push_back((byte)(i * 4 + j));
+
+		for (uint32 j = 0; j < 4; j++) {
+			data.push_back((byte)(i >> 8));
+			data.push_back((byte)(i + j));
+		}
+
+		decompressedSize += 16;
+	}
+
+	std::vector<byte> resource(18);
+	WRITE_UINT32_BE(&resource[0], 0xA89F6572);
+	WRITE_UINT16_BE(&resource[4], 18);
+	resource[6] = 9;
+	resource[7] = 1;
+	WRITE_UINT32_BE(&resource[8], decompressedSize);
+	WRITE_UINT16_BE(&resource[12], 2);
+	resource[16] = 0xFF; // Default table
+	resource[17] = 2;    // Tagged
+	resource.insert(resource.end(), data.begin(), data.end());
+	return resource;
+}
+
+static void benchDecompressor(const char *name, const std::vector<byte> &resource, uint32 decompressedSize) {
+	std::vector<byte> output(decompressedSize);
+
+	const uint32 iterations = 2000;
+	Clock::time_point start = Clock::now();
+
+	for (uint32 i = 0; i < iterations; i++) {
+		if (!decompressResource(&resource[0], resource.size(), &output[0], output.size())) {
+			printf("%s: decompression failed\n", name);
+			return;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	printf("%s: %u x %u bytes in %.3fs, %.1f MB/s\n", name, iterations, decompressedSize, seconds, iterations * (double)decompressedSize / seconds / (1024 * 1024));
+}
+
+static void benchDcmp0() {
+	uint32 decompressedSize;
+	std::vector<byte> resource = makeDcmp0Resource(decompressedSize);
+	benchDecompressor("dcmp0", resource, decompressedSize);
+}
+
+static void benchDcmp1() {
+	uint32 decompressedSize;
+	std::vector<byte> resource = makeDcmp1Resource(decompressedSize);
+	benchDecompressor("dcmp1", resource, decompressedSize);
+}
+
+static void benchDcmp2() {
+	uint32 decompressedSize;
+	std::vector<byte> resource = makeDcmp2Resource(decompressedSize);
+	benchDecompressor("dcmp2", resource, decompressedSize);
+}
+
+// An in-memory fork of 'TEXT' resources from 1K to 64K
+static byte *makeFork(uint32 resourceCount, uint32 &size) {
+	std::vector<byte> data;
+
+	for (uint32 i = 0; i < resourceCount; i++) {
+		uint32 length = 1024 + (i * 7919) % (63 * 1024);
+		byte lengthBytes[4];
+		WRITE_UINT32_BE(lengthBytes, length);
+		data.insert(data.end(), lengthBytes, lengthBytes + 4);
+		data.resize(data.size() + length, (byte)i);
+	}
+
+	uint32 typeListSize = 2 + 8;
+	uint32 mapSize = 28 + typeListSize + resourceCount * 12;
+	size = 256 + data.size() + mapSize;
+
+	byte *fork = new byte[size];
+	memset(fork, 0, size);
+	WRITE_UINT32_BE(fork, 256);
+	WRITE_UINT32_BE(fork + 4, 256 + data.size());
+	WRITE_UINT32_BE(fork + 8, data.size());
+	WRITE_UINT32_BE(fork + 12, mapSize);
+	memcpy(fork + 256, &data[0], data.size());
+
+	byte *map = fork + 256 + data.size();
+	WRITE_UINT16_BE(map + 24, 28);
+	WRITE_UINT16_BE(map + 26, mapSize);
+	WRITE_UINT32_BE(map + 30, 0x54455854); // 'TEXT'
+	WRITE_UINT16_BE(map + 34, resourceCount - 1);
+	WRITE_UINT16_BE(map + 36, typeListSize);
+
+	uint32 offset = 0;
+	for (uint32 i = 0; i < resourceCount; i++) {
+		byte *ref = map + 28 + typeListSize + i * 12;
+		WRITE_UINT16_BE(ref, i);
+		WRITE_UINT16_BE(ref + 2, 0xffff);
+		WRITE_UINT32_BE(ref + 4, offset);
+		offset += 4 + READ_UINT32_BE(fork + 256 + offset);
+	}
+
+	return fork;
+}
+
+// Reading every resource of a fork over and over, as dump and convert do,
+// against reading the same bytes into a new[] buffer every time
+static void benchGetResource() {
+	const uint32 resourceCount = 200, iterations = 50;
+
+	uint32 size;
+	byte *data = makeFork(resourceCount, size);
+	byte *copyData = new byte[size];
+	memcpy(copyData, data, size);
+	MemoryReadStream copy(copyData, size);
+
+	ResourceFork resFork;
+	if (!resFork.load(new MemoryReadStream(data, size))) {
+		printf("getResource: failed to load the fork\n");
+		return;
+	}
+
+	uint64 allocationsBefore = BufferPool::getAllocationCount();
+	uint64 reusesBefore = BufferPool::getReuseCount();
+	uint64 totalBytes = 0;
+	Clock::time_point start = Clock::now();
+
+	for (uint32 i = 0; i < iterations; i++) {
+		for (uint16 id = 0; id < resourceCount; id++) {
+			DataPair pair = resFork.getResource(0x54455854, id);
+			totalBytes += pair.length;
+		}
+	}
+
+	double pooledSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	start = Clock::now();
+
+	for (uint32 i = 0; i < iterations; i++) {
+		copy.seek(256);
+
+		for (uint32 id = 0; id < resourceCount; id++) {
+			uint32 length = copy.readUint32BE();
+			byte *buffer = new byte[length];
+			copy.read(buffer, length);
+			delete[] buffer;
+		}
+	}
+
+	double plainSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	printf("getResource: %u x %u resources (%.1f MB) in %.3fs with the pool, %llu allocations and %llu reuses\n",
+			iterations, resourceCount, totalBytes / (1024.0 * 1024), pooledSeconds,
+			(unsigned long long)(BufferPool::getAllocationCount() - allocationsBefore),
+			(unsigned long long)(BufferPool::getReuseCount() - reusesBefore));
+	printf("getResource: the same copies with new[]/delete[] each time take %.3fs\n", plainSeconds);
+}
+
+struct Benchmark {
+	const char *name;
+	void (*proc)();
+};
+
+static const Benchmark s_benchmarks[] = {
+	{ "dcmp0", benchDcmp0 },
+	{ "dcmp1", benchDcmp1 },
+	{ "dcmp2", benchDcmp2 },
+	{ "getResource", benchGetResource }
+};
+
+// Runs every benchmark, or just the ones named on the command line
+int main(int argc, const char **argv) {
+	for (uint32 i = 0; i < sizeof(s_benchmarks) / sizeof(s_benchmarks[0]); i++) {
+		bool selected = (argc < 2);
+		for (int j = 1; j < argc && !selected; j++)
+			selected = !strcmp(argv[j], s_benchmarks[i].name);
+
+		if (selected)
+			s_benchmarks[i].proc();
+	}
+
+	return 0;
+}
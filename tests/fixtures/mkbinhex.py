@@ -0,0 +1,42 @@
+#!/usr/bin/env python3.10
+# Builds the BinHex 4.0 files used by test_binhex.cpp with the binhex module
+# that shipped with Python up to 3.10, so the encoder (CRCs and run length
+# coding included) is independent of the decoder under test. Needs the
+# output of mkdcmp.py. Run from tests/fixtures.
+
+import binhex
+
+from mkfork import fork
+
+# Literal 0x90 bytes, runs of them, and runs of other bytes all get escaped
+# differently by the run length coding
+PAYLOAD = b'\x90' + b'A' * 10 + b'\x90' * 6 + b'\x00' * 300 + bytes(range(256)) + b'\x90\x00\x90'
+
+def write(name, data, rsrc):
+    info = binhex.FInfo()
+    info.Type = b'APPL'
+    info.Creator = b'TEST'
+
+    with open(name, 'wb') as f:
+        encoder = binhex.BinHex((name, info, len(data), len(rsrc)), f)
+        encoder.write(data)
+        encoder.write_rsrc(rsrc)
+        encoder.close()
+
+rsrc = fork([
+    (b'TEST', 128, b'Payload', PAYLOAD),
+    (b'TEST', 129, None, b'\x90'),
+])
+
+with open('binhex.rsrc', 'wb') as f:
+    f.write(rsrc)
+
+write('both-forks.hqx', b'data fork \x90\x90\x90 ' + b'z' * 20, rsrc)
+write('rsrc-only.hqx', b'', rsrc)
+
+# Long runs decode to many times the size of the .hqx file itself
+runs = fork([
+    (b'TEST', 128, None, b'\x00' * 256 * 1024 + bytes(range(256))),
+])
+
+write('runs.hqx', b'', runs)
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# Builds the catalogs read by test_catalog.cpp: one laid out by hand from
+# the format described in catalog.h, and damaged copies of it whose tables
+# run off the end or point at things that aren't there.
+# Run from tests/fixtures.
+
+import struct
+
+HEADER_SIZE = 64
+FILE_FLAG_FORK = 1
+
+def tag(s):
+    return struct.unpack('>I', s)[0]
+
+def catalog(files, postings, names, name_refs, offsets=None, version=2):
+    # files: (path, size, mod_time, flags)
+    # postings: (tag, id, attributes, file index, name index)
+    # names: (name, first ref, ref count)
+    strings = b''
+    file_data = b''
+    for path, size, mod_time, flags in files:
+        file_data += struct.pack('<IIQqII', len(strings), len(path), size, mod_time, flags, 0)
+        strings += path
+    posting_data = b''.join(struct.pack('<IHBBII', t, i, a, 0, f, n) for t, i, a, f, n in postings)
+    name_data = b''
+    for name, first_ref, ref_count in names:
+        name_data += struct.pack('<IIII', len(strings), len(name), first_ref, ref_count)
+        strings += name
+    ref_data = b''.join(struct.pack('<I', r) for r in name_refs)
+
+    files_offset = HEADER_SIZE
+    postings_offset = files_offset + len(file_data)
+    names_offset = postings_offset + len(posting_data)
+    name_refs_offset = names_offset + len(name_data)
+    strings_offset = name_refs_offset + len(ref_data)
+    table_offsets = [files_offset, postings_offset, names_offset, name_refs_offset, strings_offset]
+    if offsets:
+        table_offsets = [offsets.get(i, o) for i, o in enumerate(table_offsets)]
+
+    header = b'MRVC' + struct.pack('<IIIII', version, len(files), len(postings), len(names), 0)
+    header += struct.pack('<5Q', *table_offsets)
+    return header + file_data + posting_data + name_data + ref_data + strings
+
+FILES = [
+    (b'disk/Finder', 1000, 2000, FILE_FLAG_FORK),
+    (b'disk/ReadMe', 12, 3000, 0),
+    (b'disk/System', 5000, 4000, FILE_FLAG_FORK),
+]
+
+# Sorted by (tag, id, file), as writeCatalog() leaves them
+POSTINGS = [
+    (tag(b'ICN#'), 128, 0, 0, 0xffffffff),
+    (tag(b'ICN#'), 128, 0, 2, 0xffffffff),
+    (tag(b'STR '), 128, 0x20, 0, 0),
+    (tag(b'STR '), 129, 0, 2, 1),
+    (tag(b'snd '), 1, 0, 2, 2),
+    (tag(b'snd '), 128, 0, 2, 2),
+]
+
+# Sorted ignoring case; "Simple Beep" has two postings
+NAMES = [
+    (b'About', 0, 1),
+    (b'names', 1, 1),
+    (b'Simple Beep', 2, 2),
+]
+NAME_REFS = [2, 3, 4, 5]
+
+def write(name, data):
+    with open(name, 'wb') as f:
+        f.write(data)
+
+good = catalog(FILES, POSTINGS, NAMES, NAME_REFS)
+write('catalog.cat', good)
+
+# Header only, then less than a header
+write('catalog-truncated.cat', good[:HEADER_SIZE + 40])
+write('catalog-short.cat', good[:HEADER_SIZE - 1])
+
+# Catalogs from before the file flags were added
+write('catalog-v1.cat', catalog(FILES, POSTINGS, NAMES, NAME_REFS, version=1))
+
+# Postings overlapping the file table
+write('catalog-overlap.cat', catalog(FILES, POSTINGS, NAMES, NAME_REFS, offsets={1: HEADER_SIZE + 8}))
+
+# A files offset so large that adding the table size wraps around to a
+# small number, which would otherwise pass the ordering checks
+write('catalog-wrapped.cat', catalog(FILES, [], [], [], offsets={0: 2**64 - 32}))
+
+# Tables that fit, but whose entries point past the string pool or at
+# postings and files that don't exist
+write('catalog-bad-refs.cat', catalog(
+    [(b'disk/Finder', 1000, 2000, FILE_FLAG_FORK)],
+    [(tag(b'STR '), 128, 0, 5, 7), (tag(b'STR '), 129, 0, 0, 0)],
+    [(b'About', 0, 3)],
+    [1, 99]))
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# Builds the System 7 compressed resources used by test_dcmp.cpp. Each one is
+# assembled code by code from the published descriptions of 'dcmp' 0, 1 and
+# 2, with the bytes every code should expand to written out next to it, so
+# the expected output doesn't come from the decompressor under test.
+# Run from tests/fixtures.
+
+import struct
+
+def header8(dcmp_id, length):
+    return struct.pack('>IHBBIBBhH', 0xA89F6572, 18, 8, 1, length, 0, 0, dcmp_id, 0)
+
+def header9(dcmp_id, length, table_count, flags):
+    return struct.pack('>IHBBIhHBB', 0xA89F6572, 18, 9, 1, length, dcmp_id, 0, table_count, flags)
+
+def assemble(codes):
+    data = b''.join(code for code, _ in codes)
+    out = b''.join(expanded for _, expanded in codes)
+    return data, out
+
+def write(name, header_proc, codes):
+    data, out = assemble(codes)
+    with open(name + '.bin', 'wb') as f:
+        f.write(header_proc(len(out)) + data)
+    with open(name + '.out', 'wb') as f:
+        f.write(out)
+
+# 'dcmp' (0): word oriented
+write('dcmp0', lambda length: header8(0, length), [
+    (b'\x02' + b'Mac!', b'Mac!'),                   # 4 byte literal
+    (b'\x13' + b'\x4E\x56\x00\x00\x2F\x0A', b'\x4E\x56\x00\x00\x2F\x0A'), # Stored literal 0
+    (b'\x10\x02' + b'ABCD', b'ABCD'),               # Stored literal 1, length in the next byte
+    (b'\x23', b'\x4E\x56\x00\x00\x2F\x0A'),         # Stored literal 0
+    (b'\x24', b'ABCD'),                             # Stored literal 1
+    (b'\x4B\x4C\x4D\x4E', b'\x00\x00\x4E\xBA\x00\x08\x4E\x75'), # Table words 0-3
+    (b'\xFD', b'\x49\x41'),                         # Last table word
+    (b'\xFE\x02\x40\x44', b'\x00' * 5),             # Byte 0x00, 4 + 1 times
+    (b'\xFE\x03\xC1\x23\x42', b'\x01\x23' * 3),     # Word 0x0123, 2 + 1 times
+    (b'\xFE\x04\x50\x43\x01\xFF\x10', b'\x00\x10\x00\x11\x00\x10\x00\x20'), # Word deltas
+    (b'\xFE\x06\xFF\x12\x34\x56\x78\x41\x3F', b'\x12\x34\x56\x78\x12\x34\x56\x77'), # Long deltas
+    (b'\xFF', b''),
+])
+
+# 'dcmp' (1): byte oriented
+write('dcmp1', lambda length: header8(1, length), [
+    (b'\x00' + b'!', b'!'),                         # 1 byte literal
+    (b'\x12' + b'abc', b'abc'),                     # Stored literal 0
+    (b'\xD1\x05' + b'hello', b'hello'),             # Stored literal 1, length in the next byte
+    (b'\xD0\x03' + b'xyz', b'xyz'),                 # Literal, not stored
+    (b'\x20', b'abc'),                              # Stored literal 0
+    (b'\x21', b'hello'),                            # Stored literal 1
+    (b'\xD5\xD6\xD9', b'\x00\x00\x00\x01\x2E\x01'), # Table words 0, 1 and 4
+    (b'\xFD', b'\x36\x37'),                         # Last table word
+    (b'\xFE\x02\x60\x42', b'\x20' * 3),             # Byte 0x20, 2 + 1 times
+    (b'\xFF', b''),
+])
+
+# 'dcmp' (2) with the default table, untagged: every byte is a table index,
+# except for the last one when the output has an odd length
+write('dcmp2-default', lambda length: header9(2, length, 0, 0), [
+    (b'\x00\x01\x02\x03', b'\x00\x00\x00\x08\x4E\xBA\x20\x6E'),
+    (b'\x04', b'\x4E\x75'),
+    (b'Z', b'Z'),
+])
+
+# 'dcmp' (2) with its own table, tagged: each tag byte covers eight words,
+# high bit first, set bits being table indexes
+table = [0x1234, 0xABCD, 0x0000]
+
+def custom_header(length):
+    return header9(2, length, len(table) - 1, 3) + b''.join(struct.pack('>H', x) for x in table)
+
+write('dcmp2-custom', custom_header, [
+    (b'\xA5', b''),                                 # 1010 0101
+    (b'\x00', b'\x12\x34'),
+    (b'Hi', b'Hi'),
+    (b'\x01', b'\xAB\xCD'),
+    (b'!!', b'!!'),
+    (b'??', b'??'),
+    (b'\x02', b'\x00\x00'),
+    (b'..', b'..'),
+    (b'\x01', b'\xAB\xCD'),
+    (b'\x40', b''),                                 # 0100 0000, cut short
+    (b'ab', b'ab'),
+    (b'\x00', b'\x12\x34'),
+    (b'q', b'q'),                                   # Odd length: one last literal byte
+])
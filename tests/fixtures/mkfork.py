@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+# Builds the raw resource forks used by the tests, after the layout in
+# Inside Macintosh: More Macintosh Toolbox. Needs the output of mkdcmp.py.
+# Run from tests/fixtures.
+
+import struct
+
+RES_COMPRESSED = 0x01
+
+# dead_space bytes of junk follow every payload, as ResEdit leaves behind
+def fork(resources, dead_space=0):
+    data = b''
+    refs = {}
+    for resource in resources:
+        tag, id_, name, payload = resource[:4]
+        attributes = resource[4] if len(resource) > 4 else 0
+        length = resource[5] if len(resource) > 5 else len(payload)
+        refs.setdefault(tag, []).append((id_, name, len(data), attributes))
+        data += struct.pack('>I', length) + payload + b'\xDE' * dead_space
+
+    tags = list(refs)
+    type_list = struct.pack('>H', (len(tags) - 1) & 0xFFFF)
+    ref_lists = b''
+    names = b''
+    ref_list_offset = 2 + 8 * len(tags)
+
+    for tag in tags:
+        type_list += struct.pack('>4sHH', tag, len(refs[tag]) - 1, ref_list_offset + len(ref_lists))
+        for id_, name, offset, attributes in refs[tag]:
+            name_offset = 0xFFFF
+            if name is not None:
+                name_offset = len(names)
+                names += bytes([len(name)]) + name
+            ref_lists += struct.pack('>hHII', id_, name_offset, (attributes << 24) | offset, 0)
+
+    map_ = bytes(24) + struct.pack('>HH', 28, 28 + len(type_list) + len(ref_lists)) + type_list + ref_lists + names
+    header = struct.pack('>IIII', 256, 256 + len(data), len(data), len(map_))
+    return header + bytes(240) + data + map_
+
+def read(name):
+    with open(name, 'rb') as f:
+        return f.read()
+
+def write(name, data):
+    with open(name, 'wb') as f:
+        f.write(data)
+
+# A compressed resource header naming 'dcmp' (5), then some bytes for it
+UNKNOWN_DCMP = struct.pack('>IHBBIBBhH', 0xA89F6572, 18, 8, 1, 16, 0, 0, 5, 0) + b'custom data'
+
+if __name__ == '__main__':
+    # One resource compressed with each 'dcmp', one that doesn't decompress,
+    # one whose length runs past the end of the fork and one needing a 'dcmp'
+    # there's no decompressor for
+    write('compressed.rsrc', fork([
+        (b'TEXT', 128, None, read('dcmp0.bin'), RES_COMPRESSED),
+        (b'TEXT', 129, None, read('dcmp1.bin'), RES_COMPRESSED),
+        (b'TEXT', 130, None, read('dcmp2-custom.bin'), RES_COMPRESSED),
+        (b'TEXT', 131, None, read('dcmp1.bin')[:18] + b'\x00a\xD3\xFF', RES_COMPRESSED),
+        (b'TEXT', 132, None, b'plain', 0),
+        (b'TEXT', 133, None, b'short', 0, 0x10000),
+        (b'TEXT', 134, None, UNKNOWN_DCMP, RES_COMPRESSED),
+    ]))
+
+    # Named resources, with one name used under two types
+    write('names.rsrc', fork([
+        (b'TEXT', 128, b'Read Me', b'first'),
+        (b'TEXT', 129, b'Other', b'second'),
+        (b'PICT', 128, b'Read Me', b'picture'),
+    ]))
+
+    # 'STR ' and 'STR#' resources, good and bad, with MacRoman text
+    write('strings.rsrc', fork([
+        (b'STR ', 128, None, b'\x0cCaf\x8e\rd\x8ej\x88 vu'),
+        (b'STR ', 129, None, b'\x10too short'),
+        (b'STR#', 128, None, b'\x00\x03' + b'\x03One' + b'\x00' + b'\x05Three'),
+        (b'STR#', 129, None, b'\x00\x00'),
+        (b'STR#', 130, None, b'\x00\x03' + b'\x03One' + b'\x03Two'),
+        (b'STR#', 131, None, b'\x00\x01' + b'\x09Truncated'[:5]),
+        (b'STR#', 132, None, b'\x00'),
+    ]))
+
+    # Two references with the same payload, and junk between every payload
+    write('rewrite.rsrc', fork([
+        (b'TEXT', 128, b'Shared', b'the same bytes'),
+        (b'TEXT', 129, None, b'different bytes'),
+        (b'PICT', 128, None, b'the same bytes'),
+    ], dead_space=100))
+
+    # Two forks to chain, the first overriding the second's 'TEXT' 128
+    write('chain-first.rsrc', fork([
+        (b'TEXT', 128, b'Shared Name', b'first 128'),
+        (b'TEXT', 129, None, b'first 129'),
+        (b'ICN#', 128, None, b'\x11' * 256),
+    ]))
+    write('chain-second.rsrc', fork([
+        (b'TEXT', 128, b'Hidden', b'second 128'),
+        (b'TEXT', 130, b'Read Me', b'second 130'),
+        (b'PICT', 128, b'shared name', b'picture'),
+        (b'ics#', 128, None, b'\x22' * 64),
+    ]))
+
+    # Two versions of a fork to diff: same-sized edits, a MacRoman rename
+    write('diff-old.rsrc', fork([
+        (b'TEXT', 128, b'Same', b'unchanged'),
+        (b'TEXT', 129, None, b'old bytes'),
+        (b'TEXT', 130, b'Caf\x8e', b'renamed'),
+        (b'PICT', 128, None, b'removed'),
+    ]))
+    write('diff-new.rsrc', fork([
+        (b'TEXT', 128, b'Same', b'unchanged'),
+        (b'TEXT', 129, None, b'new bytes'),
+        (b'TEXT', 130, b'Th\x8e', b'renamed'),
+        (b'TEXT', 131, None, b'added'),
+    ]))
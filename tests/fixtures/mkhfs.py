@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+# Builds the small HFS and HFS+ images used by test_hfs.cpp, laid out by hand
+# from Inside Macintosh: Files and TN1150. Run from tests/fixtures.
+
+import struct
+
+def rsrc_bytes(seed, length):
+    return bytes((seed + i * 7) & 0xFF for i in range(length))
+
+def node(node_size, kind, records, flink=0, height=1):
+    data = bytearray(node_size)
+    struct.pack_into('>IIbBHH', data, 0, flink, 0, kind, height, len(records), 0)
+    offset = 14
+    offsets = []
+    for record in records:
+        offsets.append(offset)
+        data[offset:offset + len(record)] = record
+        offset += len(record)
+    offsets.append(offset)
+    for i, value in enumerate(offsets):
+        struct.pack_into('>H', data, node_size - 2 * (i + 1), value)
+    return bytes(data)
+
+def header_node(node_size, first_leaf, total_nodes):
+    record = struct.pack('>HIIIIHHII', 1, first_leaf, 0, first_leaf, first_leaf, node_size, 37, total_nodes, 0)
+    return node(node_size, 1, [record + bytes(106 - len(record))], height=0)
+
+# HFS
+
+def hfs_key(parent, name):
+    name = name.encode('mac_roman')
+    key = struct.pack('>BIB', 0, parent, len(name)) + name
+    key = bytes([len(key)]) + key
+    return key + bytes(len(key) & 1)
+
+def hfs_folder(parent, name, folder_id):
+    return hfs_key(parent, name) + struct.pack('>BBHHI', 1, 0, 0, 0, folder_id) + bytes(60)
+
+def hfs_file(parent, name, file_id, type_, creator, rsrc_size, rsrc_extents):
+    data = bytearray(102)
+    data[0] = 2
+    data[4:8] = type_
+    data[8:12] = creator
+    struct.pack_into('>I', data, 20, file_id)
+    struct.pack_into('>I', data, 36, rsrc_size)
+    for i, (start, count) in enumerate(rsrc_extents):
+        struct.pack_into('>HH', data, 86 + i * 4, start, count)
+    return hfs_key(parent, name) + bytes(data)
+
+def hfs_thread(parent, name):
+    return hfs_key(parent, '') + bytes([3]) + bytes(9) + struct.pack('>I', parent) + bytes([len(name)]) + name.encode() + bytes(31 - len(name))
+
+def hfs_extent(file_id, fork_type, start_block, extents):
+    record = struct.pack('>BBIH', 7, fork_type, file_id, start_block)
+    for start, count in extents:
+        record += struct.pack('>HH', start, count)
+    return record + bytes(20 - len(record))
+
+def build_hfs(loop=False, bad_count=False):
+    block = 512
+    alloc_start = 4 # In sectors
+    image = bytearray(alloc_start * 512 + 12 * block)
+
+    def put_block(index, data):
+        offset = alloc_start * 512 + index * block
+        image[offset:offset + len(data)] = data
+
+    # Extents overflow file: blocks 0-1, the second extent of 'Big'
+    put_block(0, header_node(block, 1, 2))
+    put_block(1, node(block, -1, [hfs_extent(20, 0xFF, 1, [(9, 1)])]))
+
+    # Catalog file: blocks 2-4, two leaves chained together
+    put_block(2, header_node(block, 1, 3))
+    put_block(3, node(block, -1, [
+        hfs_folder(1, 'Test Volume', 2),
+        hfs_thread(2, 'Test Volume'),
+        hfs_folder(2, 'Caf\u00e9', 16),
+        hfs_file(16, 'Res/File', 17, b'TEXT', b'ttxt', 300, [(5, 1)]),
+    ], flink=1 if loop else 2))
+    put_block(4, node(block, -1, [
+        hfs_file(2, 'Big', 20, b'APPL', b'TEST', 1024, [(6, 1)]),
+        hfs_file(2, 'NoRsrc', 21, b'TEXT', b'ttxt', 0, []),
+    ], flink=1 if loop else 0))
+
+    # A record count whose offset table would be bigger than the node
+    if bad_count:
+        offset = alloc_start * 512 + 4 * block + 10
+        image[offset:offset + 2] = b'\xff\xff'
+
+    put_block(5, rsrc_bytes(1, 300))
+    put_block(6, rsrc_bytes(2, 1024)[:512])
+    put_block(9, rsrc_bytes(2, 1024)[512:])
+
+    mdb = bytearray(512)
+    struct.pack_into('>H', mdb, 0, 0x4244)
+    struct.pack_into('>HI', mdb, 18, 12, block)
+    struct.pack_into('>H', mdb, 28, alloc_start)
+    mdb[36:48] = b'\x0bTest Volume'
+    struct.pack_into('>IHH', mdb, 130, 2 * block, 0, 2)
+    struct.pack_into('>IHH', mdb, 146, 3 * block, 2, 3)
+    image[1024:1536] = mdb
+    return bytes(image)
+
+# HFS+
+
+def hfsplus_key(parent, name):
+    name = name.encode('utf-16-be')
+    return struct.pack('>HIH', 6 + len(name), parent, len(name) // 2) + name
+
+def hfsplus_folder(parent, name, folder_id):
+    return hfsplus_key(parent, name) + struct.pack('>HHII', 1, 0, 0, folder_id) + bytes(76)
+
+def hfsplus_fork(size, extents):
+    data = struct.pack('>QII', size, 0, sum(count for _, count in extents))
+    for start, count in extents:
+        data += struct.pack('>II', start, count)
+    return data + bytes(80 - len(data))
+
+def hfsplus_file(parent, name, file_id, type_, creator, rsrc_size, rsrc_extents):
+    data = bytearray(248)
+    struct.pack_into('>HHII', data, 0, 2, 0, 0, file_id)
+    data[48:52] = type_
+    data[52:56] = creator
+    data[88:168] = hfsplus_fork(0, [])
+    data[168:248] = hfsplus_fork(rsrc_size, rsrc_extents)
+    return hfsplus_key(parent, name) + bytes(data)
+
+def build_hfsplus():
+    block = 4096
+    image = bytearray(8 * block)
+
+    def put_block(index, data):
+        image[index * block:index * block + len(data)] = data
+
+    # Catalog file: blocks 1-2 (no extents overflow file)
+    put_block(1, header_node(block, 1, 2))
+    put_block(2, node(block, -1, [
+        hfsplus_folder(1, 'Test Volume', 2),
+        hfsplus_folder(2, 'Für', 16),
+        hfsplus_file(16, 'Icon\U0001F600', 17, b'rsrc', b'RSED', 5000, [(3, 1), (5, 1)]),
+    ]))
+
+    put_block(3, rsrc_bytes(3, 5000)[:4096])
+    put_block(5, rsrc_bytes(3, 5000)[4096:])
+
+    header = bytearray(512)
+    struct.pack_into('>HH', header, 0, 0x482B, 4)
+    struct.pack_into('>II', header, 40, block, 8)
+    header[272:352] = hfsplus_fork(2 * block, [(1, 2)])
+    image[1024:1536] = header
+    return bytes(image)
+
+def diskcopy(image):
+    header = bytearray(84)
+    header[0:12] = b'\x0bTest Volume'
+    struct.pack_into('>II', header, 64, len(image), 0)
+    struct.pack_into('>H', header, 82, 0x0100)
+    return bytes(header) + image
+
+def write(name, data):
+    with open(name, 'wb') as f:
+        f.write(data)
+
+write('hfs.img', build_hfs())
+write('hfs-loop.img', build_hfs(loop=True))
+write('hfs-count.img', build_hfs(bad_count=True))
+write('hfs.dc42', diskcopy(build_hfs()))
+write('hfsplus.img', build_hfsplus())
@@ -0,0 +1,101 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+struct Test {
+	const char *name;
+	TestProc proc;
+};
+
+// Function-local so that registration doesn't depend on the order in which
+// the test files' statics are initialized
+static std::vector<Test> &getTests() {
+	static std::vector<Test> tests;
+	return tests;
+}
+
+static uint32 s_failureCount = 0;
+
+TestRegistration::TestRegistration(const char *name, TestProc proc) {
+	Test test = { name, proc };
+	getTests().push_back(test);
+}
+
+void reportFailure(const char *file, int line, const char *expression) {
+	fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+	s_failureCount++;
+}
+
+std::string getFixturePath(const char *name) {
+	return std::string("fixtures/") + name;
+}
+
+bool readFixture(const char *name, std::vector<byte> &data) {
+	FILE *file = fopen(getFixturePath(name).c_str(), "rb");
+	if (!file) {
+		fprintf(stderr, "Missing fixture '%s'\n", name);
+		return false;
+	}
+
+	data.clear();
+
+	byte buffer[4096];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), file)) != 0)
+		data.insert(data.end(), buffer, buffer + length);
+
+	fclose(file);
+	return true;
+}
+
+// Runs every test, or just the ones named on the command line
+int main(int argc, const char **argv) {
+	const std::vector<Test> &tests = getTests();
+	uint32 failedTests = 0, runTests = 0;
+
+	for (uint32 i = 0; i < tests.size(); i++) {
+		bool selected = (argc < 2);
+		for (int j = 1; j < argc && !selected; j++)
+			selected = !strcmp(argv[j], tests[i].name);
+
+		if (!selected)
+			continue;
+
+		uint32 failuresBefore = s_failureCount;
+		tests[i].proc();
+		runTests++;
+
+		if (s_failureCount != failuresBefore) {
+			printf("FAIL %s\n", tests[i].name);
+			failedTests++;
+		} else {
+			printf("ok   %s\n", tests[i].name);
+		}
+	}
+
+	printf("%u of %u tests passed\n", runTests - failedTests, runTests);
+	return failedTests ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef TESTS_TEST_H
+#define TESTS_TEST_H
+
+#include <string>
+#include <vector>
+#include "../types.h"
+
+// A tiny harness: each TEST() registers itself before main() runs, and a
+// failed CHECK() is reported without stopping the rest of the test.
+
+typedef void (*TestProc)();
+
+struct TestRegistration {
+	TestRegistration(const char *name, TestProc proc);
+};
+
+void reportFailure(const char *file, int line, const char *expression);
+
+// Fixtures live in tests/fixtures; the tests are run from tests/
+std::string getFixturePath(const char *name);
+bool readFixture(const char *name, std::vector<byte> &data);
+
+#define TEST(name) \
+	static void test_##name(); \
+	static TestRegistration s_registration_##name(#name, test_##name); \
+	static void test_##name()
+
+#define CHECK(x) \
+	do { \
+		if (!(x)) \
+			reportFailure(__FILE__, __LINE__, #x); \
+	} while (0)
+
+#endif
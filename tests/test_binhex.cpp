@@ -0,0 +1,127 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../binhex.h"
+#include "../macresfork.h"
+#include "test.h"
+
+// Decode a BinHex file held in memory
+static bool decodeResourceFork(std::vector<byte> &hqx, std::vector<byte> &rsrc) {
+	FILE *file = fmemopen(&hqx[0], hqx.size(), "rb");
+	if (!file)
+		return false;
+
+	SeekableReadStream *stream = decodeBinHexResourceFork(file);
+	fclose(file);
+
+	if (!stream)
+		return false;
+
+	rsrc.resize(stream->size());
+	bool success = rsrc.empty() || stream->read(&rsrc[0], rsrc.size()) == rsrc.size();
+	delete stream;
+	return success;
+}
+
+// The fixtures come from fixtures/mkbinhex.py, using an independent encoder
+static void checkFixture(const char *name) {
+	std::vector<byte> hqx, expected, rsrc;
+	CHECK(readFixture(name, hqx));
+	CHECK(readFixture("binhex.rsrc", expected));
+	CHECK(decodeResourceFork(hqx, rsrc));
+	CHECK(rsrc == expected);
+}
+
+TEST(binHexBothForks) {
+	checkFixture("both-forks.hqx");
+}
+
+TEST(binHexEmptyDataFork) {
+	checkFixture("rsrc-only.hqx");
+}
+
+TEST(binHexLoadFork) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("both-forks.hqx").c_str()));
+
+	// Runs and literal 0x90 bytes survive the run length coding
+	DataPair pair = resFork.getResource(0x54455354, 128); // 'TEST'
+	CHECK(pair && pair.length == 1 + 10 + 6 + 300 + 256 + 3);
+	if (pair && pair.length == 576) {
+		CHECK(pair.data[0] == 0x90 && pair.data[1] == 'A' && pair.data[10] == 'A');
+		CHECK(pair.data[11] == 0x90 && pair.data[16] == 0x90 && pair.data[17] == 0);
+		CHECK(pair.data[316] == 0 && pair.data[317] == 0 && pair.data[572] == 0xFF);
+		CHECK(pair.data[573] == 0x90 && pair.data[574] == 0 && pair.data[575] == 0x90);
+	}
+
+	pair = resFork.getResource(0x54455354, 129);
+	CHECK(pair && pair.length == 1 && pair.data[0] == 0x90);
+}
+
+TEST(binHexLongRuns) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("runs.hqx").c_str()));
+
+	// Decodes to far more than the .hqx file holds, so the fork's buffer
+	// has to grow past what was reserved up front
+	DataPair pair = resFork.getResource(0x54455354, 128); // 'TEST'
+	CHECK(pair && pair.length == 256 * 1024 + 256);
+	if (pair && pair.length == 256 * 1024 + 256) {
+		CHECK(pair.data[0] == 0 && pair.data[256 * 1024 - 1] == 0);
+		CHECK(pair.data[256 * 1024 + 1] == 1 && pair.data[256 * 1024 + 255] == 0xFF);
+	}
+}
+
+TEST(binHexCorrupt) {
+	static const char *alphabet = "!\"#$%&'()*+,-012345689@ABCDEFGHIJKLMNPQRSTUVXYZ[`abcdefhijklmpqr";
+
+	std::vector<byte> hqx, rsrc;
+	CHECK(readFixture("both-forks.hqx", hqx));
+	if (hqx.empty())
+		return;
+
+	byte *start = (byte *)memchr(&hqx[0], ':', hqx.size());
+	byte *end = (byte *)memchr(start + 1, ':', &hqx[0] + hqx.size() - start - 1);
+	CHECK(start && end);
+	if (!start || !end)
+		return;
+
+	// Changing any one character has to be caught by one of the three CRCs.
+	// The last character before the closing colon may only carry padding.
+	for (byte *c = start + 1; c < end - 1; c++) {
+		const char *value = strchr(alphabet, *c);
+		if (!value || !*c)
+			continue;
+
+		byte original = *c;
+		*c = (value[1] != 0) ? value[1] : alphabet[0];
+		CHECK(!decodeResourceFork(hqx, rsrc));
+		*c = original;
+	}
+
+	// Cut short
+	std::vector<byte> truncated(hqx.begin(), hqx.begin() + (end - &hqx[0]) / 2);
+	CHECK(!decodeResourceFork(truncated, rsrc));
+}
@@ -0,0 +1,189 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../catalog.h"
+#include "test.h"
+
+#define ICON_LIST_TAG 0x49434E23 // 'ICN#'
+#define PICT_TAG      0x50494354 // 'PICT'
+#define STR_TAG       0x53545220 // 'STR '
+
+// The fixtures come from fixtures/mkcatalog.py
+TEST(catalogRead) {
+	Catalog catalog;
+	CHECK(catalog.open(getFixturePath("catalog.cat").c_str()));
+	CHECK(catalog.getFileCount() == 3 && catalog.getPostingCount() == 6);
+
+	CHECK(catalog.getFilePath(1) == "disk/ReadMe");
+	CHECK(catalog.getFileSize(2) == 5000 && catalog.getFileModTime(2) == 4000);
+	CHECK(catalog.isFileFork(0) && !catalog.isFileFork(1) && catalog.isFileFork(2));
+	CHECK(catalog.getFilePath(3).empty() && !catalog.isFileFork(3));
+
+	CHECK(catalog.findByTag(ICON_LIST_TAG).size() == 2);
+	CHECK(catalog.findByTag(PICT_TAG).empty());
+	CHECK(catalog.findByID(128).size() == 4);
+
+	std::vector<uint32> postings = catalog.findByTagAndID(STR_TAG, 129);
+	CHECK(postings.size() == 1);
+
+	if (postings.size() == 1) {
+		Catalog::Posting posting = catalog.getPosting(postings[0]);
+		CHECK(posting.fileIndex == 2 && catalog.getName(posting.nameIndex) == "names");
+	}
+
+	// Names are matched whole, ignoring case
+	CHECK(catalog.findByName("simple beep") == std::vector<uint32>({ 4, 5 }));
+	CHECK(catalog.findByName("ABOUT") == std::vector<uint32>({ 2 }));
+	CHECK(catalog.findByName("Abou").empty());
+}
+
+TEST(catalogRejectsDamage) {
+	static const char *const s_names[] = {
+		"catalog-short.cat",
+		"catalog-truncated.cat",
+		"catalog-v1.cat",
+		"catalog-overlap.cat",
+		"catalog-wrapped.cat"
+	};
+
+	for (uint32 i = 0; i < sizeof(s_names) / sizeof(s_names[0]); i++) {
+		Catalog catalog;
+		CHECK(!catalog.open(getFixturePath(s_names[i]).c_str()));
+		CHECK(!catalog.isOpen() && catalog.getFileCount() == 0);
+	}
+}
+
+TEST(catalogBadReferences) {
+	Catalog catalog;
+	CHECK(catalog.open(getFixturePath("catalog-bad-refs.cat").c_str()));
+
+	Catalog::Posting posting = catalog.getPosting(0);
+	CHECK(catalog.getFilePath(posting.fileIndex).empty() && catalog.getName(posting.nameIndex).empty());
+
+	// Only the name reference that leads somewhere survives
+	CHECK(catalog.findByName("About") == std::vector<uint32>({ 1 }));
+
+	std::vector<CatalogFile> files;
+	catalog.getFiles(files);
+	CHECK(files.size() == 1 && files[0].resources.size() == 1 && files[0].resources[0].name == "About");
+}
+
+static bool writeCatalogFile(const std::string &path, const std::vector<CatalogFile> &files) {
+	FILE *output = fopen(path.c_str(), "wb");
+	if (!output)
+		return false;
+
+	bool result = writeCatalog(output, files);
+	return (fclose(output) == 0) && result;
+}
+
+static void writeFile(const std::string &path, const std::vector<byte> &data) {
+	FILE *output = fopen(path.c_str(), "wb");
+	CHECK(output && fwrite(data.data(), 1, data.size(), output) == data.size());
+
+	if (output)
+		fclose(output);
+}
+
+TEST(catalogRoundTrip) {
+	char rootPath[] = "/tmp/macresview-test.XXXXXX";
+	CHECK(mkdtemp(rootPath) != 0);
+
+	std::vector<CatalogFile> files(2);
+	files[0].path = "b/Fork";
+	files[0].size = 10;
+	files[0].modTime = -5;
+	files[0].isFork = true;
+	files[0].resources.resize(1);
+	files[0].resources[0].tag = STR_TAG;
+	files[0].resources[0].id = 0xffff;
+	files[0].resources[0].attributes = 0x20;
+	files[0].resources[0].name = "Name";
+	files[1].path = "a/Text";
+	files[1].size = 20;
+	files[1].modTime = 30;
+	files[1].isFork = false;
+
+	std::string catalogPath = std::string(rootPath) + "/test.cat";
+	CHECK(writeCatalogFile(catalogPath, files));
+
+	Catalog catalog;
+	CHECK(catalog.open(catalogPath.c_str()));
+
+	std::vector<CatalogFile> readFiles;
+	catalog.getFiles(readFiles);
+	CHECK(readFiles.size() == 2);
+
+	if (readFiles.size() == 2) {
+		CHECK(readFiles[0].path == "b/Fork" && readFiles[0].size == 10 && readFiles[0].modTime == -5 && readFiles[0].isFork);
+		CHECK(readFiles[0].resources.size() == 1 && readFiles[0].resources[0].id == 0xffff && readFiles[0].resources[0].name == "Name");
+		CHECK(readFiles[1].path == "a/Text" && !readFiles[1].isFork && readFiles[1].resources.empty());
+	}
+
+	catalog.close();
+	unlink(catalogPath.c_str());
+	rmdir(rootPath);
+}
+
+TEST(catalogIndexDirectory) {
+	char rootPath[] = "/tmp/macresview-test.XXXXXX";
+	CHECK(mkdtemp(rootPath) != 0);
+
+	std::vector<byte> data;
+	CHECK(readFixture("names.rsrc", data));
+	writeFile(std::string(rootPath) + "/Fork", data);
+
+	data.assign(100, 'x');
+	writeFile(std::string(rootPath) + "/Text", data);
+
+	// The catalog lives in the tree it indexes, and is spelled differently
+	std::string catalogPath = std::string(rootPath) + "/index.cat";
+	std::string skipPath = std::string(rootPath) + "/./index.cat";
+
+	Catalog previous;
+	std::vector<CatalogFile> files;
+	IndexStats stats;
+	indexDirectory(rootPath, skipPath, previous, 2, files, stats);
+	CHECK(files.size() == 2 && stats.parsedCount == 1 && stats.nonForkCount == 1 && stats.reusedCount == 0);
+	CHECK(writeCatalogFile(catalogPath, files));
+
+	// Nothing changed, so the second run reads nothing but still knows
+	// which files weren't forks, and leaves the catalog out
+	CHECK(previous.open(catalogPath.c_str()));
+	indexDirectory(rootPath, skipPath, previous, 2, files, stats);
+	CHECK(files.size() == 2 && stats.parsedCount == 0 && stats.nonForkCount == 1 && stats.reusedCount == 1);
+
+	if (files.size() == 2) {
+		CHECK(files[0].path == std::string(rootPath) + "/Fork" && files[0].isFork && !files[0].resources.empty());
+		CHECK(files[1].path == std::string(rootPath) + "/Text" && !files[1].isFork);
+	}
+
+	previous.close();
+	unlink(catalogPath.c_str());
+	unlink((std::string(rootPath) + "/Fork").c_str());
+	unlink((std::string(rootPath) + "/Text").c_str());
+	rmdir(rootPath);
+}
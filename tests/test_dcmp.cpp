@@ -0,0 +1,146 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "../dcmp.h"
+#include "../util.h"
+#include "test.h"
+
+// The fixtures come from fixtures/mkdcmp.py, each with its expected output
+static void checkFixture(const char *name) {
+	std::vector<byte> compressed, expected;
+	CHECK(readFixture((std::string(name) + ".bin").c_str(), compressed));
+	CHECK(readFixture((std::string(name) + ".out").c_str(), expected));
+	if (compressed.empty() || expected.empty())
+		return;
+
+	CHECK(isCompressedResource(&compressed[0], compressed.size()));
+	CHECK(isPlausibleDecompressedSize(&compressed[0], compressed.size()));
+	CHECK(getDecompressedSize(&compressed[0]) == expected.size());
+
+	std::vector<byte> output(expected.size());
+	CHECK(decompressResource(&compressed[0], compressed.size(), &output[0], output.size()));
+	CHECK(output == expected);
+
+	// Every byte is needed
+	for (uint32 length = 18; length < compressed.size(); length++)
+		CHECK(!decompressResource(&compressed[0], length, &output[0], output.size()));
+
+	// The caller's buffer has to match the header
+	CHECK(!decompressResource(&compressed[0], compressed.size(), &output[0], output.size() - 1));
+}
+
+TEST(dcmp0) {
+	checkFixture("dcmp0");
+}
+
+TEST(dcmp1) {
+	checkFixture("dcmp1");
+}
+
+TEST(dcmp2DefaultTable) {
+	checkFixture("dcmp2-default");
+}
+
+TEST(dcmp2CustomTable) {
+	checkFixture("dcmp2-custom");
+}
+
+static std::vector<byte> makeResource(uint16 dcmpID, uint32 decompressedSize, const byte *data, uint32 length) {
+	std::vector<byte> resource(18);
+	WRITE_UINT32_BE(&resource[0], 0xA89F6572);
+	WRITE_UINT16_BE(&resource[4], 18);
+	resource[6] = 8;
+	resource[7] = 1;
+	WRITE_UINT32_BE(&resource[8], decompressedSize);
+	WRITE_UINT16_BE(&resource[14], dcmpID);
+	resource.insert(resource.end(), data, data + length);
+	return resource;
+}
+
+static bool decompress(const std::vector<byte> &resource) {
+	std::vector<byte> output(getDecompressedSize(&resource[0]) + 1);
+	return decompressResource(&resource[0], resource.size(), &output[0], output.size() - 1);
+}
+
+TEST(dcmpCorrupt) {
+	// Unassigned 'dcmp' (1) codes
+	static const byte unassignedD3[] = { 0x00, 'a', 0xD3, 0xFF };
+	static const byte unassignedD4[] = { 0x00, 'a', 0xD4, 0xFF };
+	CHECK(!decompress(makeResource(1, 1, unassignedD3, sizeof(unassignedD3))));
+	CHECK(!decompress(makeResource(1, 1, unassignedD4, sizeof(unassignedD4))));
+
+	// A stored literal that was never stored
+	static const byte missingLiteral[] = { 0x01, 'a', 'b', 0x23, 0xFF };
+	CHECK(!decompress(makeResource(0, 4, missingLiteral, sizeof(missingLiteral))));
+
+	// A literal running off the end of the input
+	static const byte longLiteral[] = { 0xD0, 0x10, 'a', 0xFF };
+	CHECK(!decompress(makeResource(1, 16, longLiteral, sizeof(longLiteral))));
+
+	// A repeat running past the size given in the header
+	static const byte longRepeat[] = { 0xFE, 0x02, 0x40, 0x7F, 0xFF };
+	CHECK(!decompress(makeResource(0, 16, longRepeat, sizeof(longRepeat))));
+
+	// Output short of the size given in the header
+	static const byte shortOutput[] = { 0x00, 'a', 0xFF };
+	CHECK(!decompress(makeResource(1, 2, shortOutput, sizeof(shortOutput))));
+
+	// No such 'dcmp'
+	CHECK(!decompress(makeResource(3, 1, shortOutput, sizeof(shortOutput))));
+
+	// A table index past the custom table
+	std::vector<byte> resource = makeResource(2, 2, 0, 0);
+	static const byte pastTable[] = { 0x12, 0x34, 0x01 };
+	resource[6] = 9;
+	WRITE_UINT16_BE(&resource[12], 2);
+	resource[16] = 0;
+	resource[17] = 1;
+	resource.insert(resource.end(), pastTable, pastTable + sizeof(pastTable));
+	CHECK(!decompress(resource));
+	resource.back() = 0;
+	CHECK(decompress(resource));
+}
+
+TEST(dcmpImplausibleSize) {
+	static const byte data[] = { 0xFF };
+	std::vector<byte> resource = makeResource(0, 0xFFFFFFFF, data, sizeof(data));
+	CHECK(isCompressedResource(&resource[0], resource.size()));
+	CHECK(!isPlausibleDecompressedSize(&resource[0], resource.size()));
+
+	resource = makeResource(0, 256 * 1024 * 1024 + 1, data, sizeof(data));
+	CHECK(!isPlausibleDecompressedSize(&resource[0], resource.size()));
+}
+
+TEST(dcmpLongRun) {
+	// A few bytes of 'dcmp' (0) can stand for a big blank image: 4MB of
+	// zeros from one byte repeat code with a 32-bit count
+	const uint32 size = 4 * 1024 * 1024;
+	static const byte data[] = { 0xFE, 0x02, 0x40, 0xFF, (size - 1) >> 24, ((size - 1) >> 16) & 0xFF, ((size - 1) >> 8) & 0xFF, (size - 1) & 0xFF, 0xFF };
+	std::vector<byte> resource = makeResource(0, size, data, sizeof(data));
+	CHECK(isPlausibleDecompressedSize(&resource[0], resource.size()));
+
+	std::vector<byte> output(size, 1);
+	CHECK(decompressResource(&resource[0], resource.size(), &output[0], output.size()));
+	CHECK(output == std::vector<byte>(size, 0));
+}
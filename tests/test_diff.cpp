@@ -0,0 +1,62 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "../diff.h"
+#include "../macresfork.h"
+#include "test.h"
+
+#define PICT_TAG 0x50494354 // 'PICT'
+#define TEXT_TAG 0x54455854 // 'TEXT'
+
+TEST(diffIdenticalForks) {
+	ResourceFork oldFork, newFork;
+	CHECK(oldFork.load(getFixturePath("diff-old.rsrc").c_str()));
+	CHECK(newFork.load(getFixturePath("diff-old.rsrc").c_str()));
+
+	CHECK(diffResourceForks(oldFork, newFork, 2).empty());
+}
+
+TEST(diffChanges) {
+	// The fixtures come from fixtures/mkfork.py
+	ResourceFork oldFork, newFork;
+	CHECK(oldFork.load(getFixturePath("diff-old.rsrc").c_str()));
+	CHECK(newFork.load(getFixturePath("diff-new.rsrc").c_str()));
+
+	// Sorted by type and ID, with the unchanged 'TEXT' 128 left out
+	std::vector<ResourceDifference> differences = diffResourceForks(oldFork, newFork, 2);
+	CHECK(differences.size() == 4);
+	if (differences.size() != 4)
+		return;
+
+	CHECK(differences[0].tag == PICT_TAG && differences[0].id == 128 && differences[0].flags == kDiffRemoved);
+	CHECK(differences[0].oldSize == 7);
+
+	// Same size, different bytes
+	CHECK(differences[1].tag == TEXT_TAG && differences[1].id == 129 && differences[1].flags == kDiffChanged);
+	CHECK(differences[1].oldSize == 9 && differences[1].newSize == 9);
+
+	// Names are reported as stored, in MacRoman
+	CHECK(differences[2].id == 130 && differences[2].flags == kDiffRenamed);
+	CHECK(differences[2].oldName == "Caf\x8E" && differences[2].newName == "Th\x8E");
+
+	CHECK(differences[3].id == 131 && differences[3].flags == kDiffAdded && differences[3].newSize == 5);
+}
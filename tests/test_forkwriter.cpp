@@ -0,0 +1,256 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../forkwriter.h"
+#include "../macresfork.h"
+#include "../util.h"
+#include "test.h"
+
+#define TEXT_TAG 0x54455854 // 'TEXT'
+
+static bool loadFromFile(ResourceFork &resFork, FILE *file) {
+	uint64 size = getFileSize(file);
+	byte *data = new byte[size];
+
+	if (!seekFile(file, 0) || fread(data, 1, size, file) != size) {
+		delete[] data;
+		return false;
+	}
+
+	return resFork.load(new MemoryReadStream(data, size));
+}
+
+TEST(forkWriterRoundTrip) {
+	ResourceFork source;
+	CHECK(source.load(getFixturePath("names.rsrc").c_str()));
+
+	FILE *output = tmpfile();
+	ResourceForkWriter writer(source);
+	CHECK(writer.write(output, kForkContainerRaw, "names"));
+	CHECK(writer.getResourceCount() == 3);
+
+	ResourceFork copy;
+	CHECK(loadFromFile(copy, output));
+	fclose(output);
+
+	CHECK(copy.getTagArray() == source.getTagArray());
+	CHECK(copy.getFilename(TEXT_TAG, 128) == "Read Me");
+	CHECK(copy.getFilename(TEXT_TAG, 129) == "Other");
+
+	DataPair pair = copy.getResource(0x50494354, 128); // 'PICT'
+	CHECK(pair && pair.length == 7 && !memcmp(pair.data, "picture", 7));
+}
+
+// A fork with idCount resources under each tag, all sharing one empty
+// payload and none of them named
+static byte *buildFork(const std::vector<uint32> &tags, uint32 idCount, uint32 &size) {
+	uint32 typeListSize = 2 + tags.size() * 8;
+	uint32 mapSize = 28 + typeListSize + tags.size() * idCount * 12;
+	size = 256 + 4 + mapSize;
+
+	byte *data = new byte[size];
+	memset(data, 0, size);
+
+	WRITE_UINT32_BE(data, 256);
+	WRITE_UINT32_BE(data + 4, 256 + 4);
+	WRITE_UINT32_BE(data + 8, 4);
+	WRITE_UINT32_BE(data + 12, mapSize);
+
+	byte *map = data + 256 + 4;
+	WRITE_UINT16_BE(map + 24, 28);
+	WRITE_UINT16_BE(map + 26, 0xffff);
+	WRITE_UINT16_BE(map + 28, tags.size() - 1);
+
+	for (uint32 i = 0; i < tags.size(); i++) {
+		byte *type = map + 28 + 2 + i * 8;
+		WRITE_UINT32_BE(type, tags[i]);
+		WRITE_UINT16_BE(type + 4, idCount - 1);
+		WRITE_UINT16_BE(type + 6, typeListSize + i * idCount * 12);
+
+		for (uint32 j = 0; j < idCount; j++) {
+			byte *ref = map + 28 + typeListSize + (i * idCount + j) * 12;
+			WRITE_UINT16_BE(ref, j);
+			WRITE_UINT16_BE(ref + 2, 0xffff);
+		}
+	}
+
+	return data;
+}
+
+TEST(forkWriterTooManyResources) {
+	std::vector<uint32> tags;
+	tags.push_back(TEXT_TAG);
+	tags.push_back(0x50494354); // 'PICT'
+
+	// The reference lists end just short of 64K into the type list, but
+	// that puts the name list offset (from the start of the map) past it
+	uint32 size;
+	byte *data = buildFork(tags, 2729, size);
+
+	ResourceFork source;
+	CHECK(source.load(new MemoryReadStream(data, size)));
+	CHECK(source.getIDArray(0x50494354).size() == 2729);
+
+	FILE *output = tmpfile();
+	ResourceForkWriter writer(source);
+	CHECK(!writer.write(output, kForkContainerRaw, "many"));
+	CHECK(getFileSize(output) == 0);
+	fclose(output);
+
+	// Just under the limit is fine
+	data = buildFork(tags, 2700, size);
+
+	ResourceFork smallerSource;
+	CHECK(smallerSource.load(new MemoryReadStream(data, size)));
+
+	output = tmpfile();
+	ResourceForkWriter smallerWriter(smallerSource);
+	CHECK(smallerWriter.write(output, kForkContainerRaw, "many"));
+
+	ResourceFork copy;
+	CHECK(loadFromFile(copy, output));
+	CHECK(copy.getIDArray(TEXT_TAG).size() == 2700);
+	fclose(output);
+}
+
+static bool hasContents(const DataPair &pair, const char *contents) {
+	return pair && pair.length == strlen(contents) && !memcmp(pair.data, contents, pair.length);
+}
+
+static bool hasRewriteResources(ResourceFork &resFork) {
+	return hasContents(resFork.getResource(TEXT_TAG, 128), "the same bytes") &&
+			hasContents(resFork.getResource(TEXT_TAG, 129), "different bytes") &&
+			hasContents(resFork.getResource(0x50494354, 128), "the same bytes") && // 'PICT'
+			resFork.getFilename(TEXT_TAG, 128) == "Shared";
+}
+
+// The fixture comes from fixtures/mkfork.py: three payloads, two of them
+// the same, each followed by 100 bytes of dead space
+TEST(forkWriterDropsDeadSpace) {
+	ResourceFork source;
+	CHECK(source.load(getFixturePath("rewrite.rsrc").c_str()));
+
+	FILE *output = tmpfile();
+	ResourceForkWriter writer(source);
+	CHECK(writer.write(output, kForkContainerRaw, "rewrite"));
+	CHECK(writer.getDuplicateCount() == 0);
+
+	ResourceFork copy;
+	CHECK(loadFromFile(copy, output));
+	fclose(output);
+
+	CHECK(hasRewriteResources(copy));
+	CHECK(copy.getForkSize() == source.getForkSize() - 3 * 100);
+}
+
+TEST(forkWriterDeduplicates) {
+	ResourceFork source;
+	CHECK(source.load(getFixturePath("rewrite.rsrc").c_str()));
+
+	FILE *output = tmpfile();
+	ResourceForkWriter writer(source);
+	writer.setDeduplicate(true);
+	CHECK(writer.write(output, kForkContainerRaw, "rewrite"));
+	CHECK(writer.getResourceCount() == 3 && writer.getDuplicateCount() == 1);
+
+	ResourceFork copy;
+	CHECK(loadFromFile(copy, output));
+	fclose(output);
+
+	// One copy of the shared payload, with both references pointing at it
+	CHECK(hasRewriteResources(copy));
+	CHECK(copy.getForkSize() == source.getForkSize() - 3 * 100 - (4 + 14));
+
+	const std::vector<ResourceForkType> &types = copy.getTypes();
+	CHECK(types.size() == 2 && types[0].ids.size() == 2 && types[1].ids.size() == 1);
+	if (types.size() == 2 && types[0].ids.size() == 2 && types[1].ids.size() == 1)
+		CHECK(types[0].ids[0].offset == types[1].ids[0].offset && types[0].ids[1].offset != types[0].ids[0].offset);
+}
+
+// Containers are recognized by what's in the file, so they go through a real path
+static void checkContainer(ForkContainer container) {
+	ResourceFork source;
+	CHECK(source.load(getFixturePath("rewrite.rsrc").c_str()));
+
+	char path[] = "/tmp/macresview-test.XXXXXX";
+	int fd = mkstemp(path);
+	CHECK(fd >= 0);
+
+	FILE *output = fdopen(fd, "wb");
+	ResourceForkWriter writer(source);
+	CHECK(output && writer.write(output, container, "Rewrite"));
+	CHECK(output && fclose(output) == 0);
+
+	ResourceFork copy;
+	CHECK(copy.load(path));
+	CHECK(hasRewriteResources(copy));
+
+	FILE *file = fopen(path, "rb");
+	byte header[128];
+	CHECK(file && fread(header, 1, sizeof(header), file) == sizeof(header));
+
+	if (container == kForkContainerMacBinary) {
+		// The name, and a fork padded out to 128 bytes
+		CHECK(header[1] == 7 && !memcmp(header + 2, "Rewrite", 7));
+		CHECK(READ_UINT32_BE(header + 87) == copy.getForkSize());
+		CHECK(file && getFileSize(file) == 128 + ((copy.getForkSize() + 127) & ~127));
+	} else {
+		CHECK(READ_UINT32_BE(header) == 0x00051607);
+		CHECK(file && getFileSize(file) == 38 + copy.getForkSize());
+	}
+
+	if (file)
+		fclose(file);
+
+	unlink(path);
+}
+
+TEST(forkWriterMacBinary) {
+	checkContainer(kForkContainerMacBinary);
+}
+
+TEST(forkWriterAppleDouble) {
+	checkContainer(kForkContainerAppleDouble);
+}
+
+TEST(forkWriterBadLength) {
+	std::vector<byte> fixture;
+	CHECK(readFixture("names.rsrc", fixture));
+
+	// The first payload claims nearly 4GB, so length + 4 would wrap to 3
+	byte *data = new byte[fixture.size()];
+	memcpy(data, &fixture[0], fixture.size());
+	WRITE_UINT32_BE(data + 256, 0xffffffff);
+
+	ResourceFork source;
+	CHECK(source.load(new MemoryReadStream(data, fixture.size())));
+
+	FILE *output = tmpfile();
+	ResourceForkWriter writer(source);
+	CHECK(!writer.write(output, kForkContainerRaw, "names"));
+	CHECK(getFileSize(output) == 0);
+	fclose(output);
+}
@@ -0,0 +1,110 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "../hfs.h"
+#include "test.h"
+
+// The fixtures come from fixtures/mkhfs.py; fork bytes follow this pattern
+static bool checkFork(const HFSVolume &volume, const HFSFile &hfsFile, const char *imageName, byte seed, uint32 size) {
+	FILE *file = fopen(getFixturePath(imageName).c_str(), "rb");
+	if (!file)
+		return false;
+
+	SeekableReadStream *stream = volume.createResourceForkStream(file, hfsFile);
+	std::vector<byte> data(size + 1);
+	bool matches = stream->size() == size && stream->read(&data[0], size + 1) == size;
+
+	for (uint32 i = 0; i < size && matches; i++)
+		matches = data[i] == (byte)(seed + i * 7);
+
+	delete stream;
+	fclose(file);
+	return matches;
+}
+
+static void checkHFSFiles(const char *imageName) {
+	HFSVolume volume;
+	CHECK(volume.open(getFixturePath(imageName).c_str()));
+
+	// The file without a resource fork is left out
+	const std::vector<HFSFile> &files = volume.getFiles();
+	CHECK(files.size() == 2);
+	if (files.size() != 2)
+		return;
+
+	// MacRoman names come out as UTF-8, and '/' can't appear in a path component
+	CHECK(files[0].path == "Caf\xC3\xA9/Res:File");
+	CHECK(files[0].fileID == 17);
+	CHECK(files[0].type == 0x54455854); // 'TEXT'
+	CHECK(files[0].creator == 0x74747874); // 'ttxt'
+	CHECK(checkFork(volume, files[0], imageName, 1, 300));
+
+	// Its second extent only appears in the extents overflow file
+	CHECK(files[1].path == "Big");
+	CHECK(files[1].rsrcExtents.size() == 2);
+	CHECK(checkFork(volume, files[1], imageName, 2, 1024));
+}
+
+TEST(hfsCatalog) {
+	checkHFSFiles("hfs.img");
+}
+
+TEST(hfsDiskCopy) {
+	checkHFSFiles("hfs.dc42");
+}
+
+TEST(hfsPlusCatalog) {
+	HFSVolume volume;
+	CHECK(volume.open(getFixturePath("hfsplus.img").c_str()));
+
+	const std::vector<HFSFile> &files = volume.getFiles();
+	CHECK(files.size() == 1);
+	if (files.size() != 1)
+		return;
+
+	// UTF-16 names, surrogate pairs included, come out as UTF-8
+	CHECK(files[0].path == "F\xC3\xBCr/Icon\xF0\x9F\x98\x80");
+	CHECK(files[0].type == 0x72737263); // 'rsrc'
+	CHECK(checkFork(volume, files[0], "hfsplus.img", 3, 5000));
+}
+
+TEST(hfsLeafLoop) {
+	// The last leaf links back to the first
+	HFSVolume volume;
+	CHECK(!volume.open(getFixturePath("hfs-loop.img").c_str()));
+	CHECK(volume.getFiles().empty());
+}
+
+TEST(hfsRecordCount) {
+	// A leaf claims more records than its offset table has room for
+	HFSVolume volume;
+	CHECK(!volume.open(getFixturePath("hfs-count.img").c_str()));
+	CHECK(volume.getFiles().empty());
+}
+
+TEST(hfsNotAVolume) {
+	HFSVolume volume;
+	CHECK(!volume.open(getFixturePath("mkhfs.py").c_str()));
+	CHECK(!volume.open(getFixturePath("missing.img").c_str()));
+}
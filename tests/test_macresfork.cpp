@@ -0,0 +1,154 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "../macresfork.h"
+#include "test.h"
+
+#define TEXT_TAG 0x54455854 // 'TEXT'
+
+static bool matchesFixture(const DataPair &pair, const char *name) {
+	std::vector<byte> expected;
+	return pair && readFixture(name, expected) && pair.length == expected.size() && !memcmp(pair.data, &expected[0], pair.length);
+}
+
+// The fixture comes from fixtures/mkfork.py
+TEST(forkCompressedResources) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("compressed.rsrc").c_str()));
+
+	CHECK(matchesFixture(resFork.getResource(TEXT_TAG, 128), "dcmp0.out"));
+	CHECK(matchesFixture(resFork.getResource(TEXT_TAG, 129), "dcmp1.out"));
+	CHECK(matchesFixture(resFork.getResource(TEXT_TAG, 130), "dcmp2-custom.out"));
+
+	DataPair plain = resFork.getResource(TEXT_TAG, 132);
+	CHECK(plain && plain.length == 5 && !memcmp(plain.data, "plain", 5));
+}
+
+TEST(forkResourcePastEnd) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("compressed.rsrc").c_str()));
+
+	// Its length would run well past the end of the fork
+	CHECK(!resFork.getResource(TEXT_TAG, 133));
+}
+
+static bool countChunk(const byte *data, uint32 length, void *context) {
+	*(uint32 *)context += length;
+	return true;
+}
+
+TEST(forkSizeMatchesPayload) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("compressed.rsrc").c_str()));
+
+	// What getResourceSize() promises is exactly what gets streamed out
+	for (uint16 id = 128; id <= 132; id++) {
+		uint32 streamed = 0;
+		bool success = resFork.readResourceChunks(TEXT_TAG, id, countChunk, &streamed);
+
+		if (id == 131) {
+			// Doesn't decompress, so can't be read any other way either
+			CHECK(!success && streamed == 0);
+			CHECK(!resFork.getResource(TEXT_TAG, id));
+		} else {
+			CHECK(success && streamed == resFork.getResourceSize(TEXT_TAG, id));
+			CHECK(resFork.getResource(TEXT_TAG, id).length == streamed);
+		}
+	}
+
+	// Runs past the end of the fork
+	uint32 streamed = 0;
+	CHECK(!resFork.readResourceChunks(TEXT_TAG, 133, countChunk, &streamed));
+}
+
+// The bytes a resource is stored as, from the fork itself
+static bool readStored(ResourceFork &resFork, uint32 tag, uint16 id, std::vector<byte> &data) {
+	const std::vector<ResourceForkType> &types = resFork.getTypes();
+
+	for (uint32 i = 0; i < types.size(); i++) {
+		for (uint32 j = 0; j < types[i].ids.size(); j++) {
+			if (types[i].tag != tag || types[i].ids[j].id != id)
+				continue;
+
+			byte lengthField[4];
+			if (resFork.readRawData(types[i].ids[j].offset, lengthField, 4) != 4)
+				return false;
+
+			data.resize(READ_UINT32_BE(lengthField));
+			return resFork.readRawData(types[i].ids[j].offset + 4, &data[0], data.size()) == data.size();
+		}
+	}
+
+	return false;
+}
+
+TEST(forkDumpKeepsStored) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("compressed.rsrc").c_str()));
+
+	// One fails to decompress and one has no decompressor; dumping either
+	// writes what's stored, where converting gets nothing
+	for (uint16 id = 131; id <= 134; id += 3) {
+		std::vector<byte> stored;
+		CHECK(readStored(resFork, TEXT_TAG, id, stored) && !stored.empty());
+
+		FILE *output = tmpfile();
+		CHECK(output && !resFork.writeResource(TEXT_TAG, id, output) && ftell(output) == 0);
+		CHECK(output && resFork.dumpResource(TEXT_TAG, id, output) && ftell(output) == (long)stored.size());
+
+		if (!output)
+			continue;
+
+		std::vector<byte> dumped(stored.size());
+		rewind(output);
+		CHECK(fread(&dumped[0], 1, dumped.size(), output) == dumped.size() && dumped == stored);
+		fclose(output);
+	}
+
+	// Ones that expand are dumped expanded
+	FILE *output = tmpfile();
+	CHECK(output && resFork.dumpResource(TEXT_TAG, 128, output) && ftell(output) == (long)resFork.getResourceSize(TEXT_TAG, 128));
+	if (output)
+		fclose(output);
+}
+
+static bool hasContents(const DataPair &pair, const char *contents) {
+	return pair && pair.length == strlen(contents) && !memcmp(pair.data, contents, pair.length);
+}
+
+TEST(forkNamedResources) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("names.rsrc").c_str()));
+
+	// Names match without regard to case, first type in the map first
+	CHECK(hasContents(resFork.getResource("Read Me"), "first"));
+	CHECK(hasContents(resFork.getResource("read me"), "first"));
+	CHECK(hasContents(resFork.getResource("OTHER"), "second"));
+	CHECK(hasContents(resFork.getResource(0x50494354, "READ ME"), "picture")); // 'PICT'
+	CHECK(hasContents(resFork.getResource(TEXT_TAG, "other"), "second"));
+
+	CHECK(!resFork.getResource("Read"));
+	CHECK(!resFork.getResource(0x50494354, "Other"));
+	CHECK(resFork.getFilename(TEXT_TAG, 129) == "Other");
+}
@@ -0,0 +1,77 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "../macresfork.h"
+#include "../macroman.h"
+#include "test.h"
+
+#define STR_TAG      0x53545220 // 'STR '
+#define STR_LIST_TAG 0x53545223 // 'STR#'
+
+// The fixture comes from fixtures/mkfork.py
+TEST(macRomanString) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("strings.rsrc").c_str()));
+
+	std::vector<std::string> strings;
+	DataPair pair = resFork.getResource(STR_TAG, 128);
+	CHECK(pair && parsePascalStrings(pair.data, pair.length, 1, strings));
+	CHECK(strings.size() == 1 && strings[0] == "Caf\xC3\xA9\nd\xC3\xA9j\xC3\xA0 vu");
+
+	// The length byte claims more than there is
+	strings.clear();
+	pair = resFork.getResource(STR_TAG, 129);
+	CHECK(pair && !parsePascalStrings(pair.data, pair.length, 1, strings));
+}
+
+TEST(macRomanStringList) {
+	ResourceFork resFork;
+	CHECK(resFork.load(getFixturePath("strings.rsrc").c_str()));
+
+	std::vector<std::string> strings;
+	DataPair pair = resFork.getResource(STR_LIST_TAG, 128);
+	CHECK(pair && parseStringList(pair.data, pair.length, strings));
+	CHECK(strings.size() == 3 && strings[0] == "One" && strings[1].empty() && strings[2] == "Three");
+
+	strings.clear();
+	pair = resFork.getResource(STR_LIST_TAG, 129);
+	CHECK(pair && parseStringList(pair.data, pair.length, strings) && strings.empty());
+
+	// Fewer strings than the count, a string cut short, and no count at all
+	for (uint16 id = 130; id <= 132; id++) {
+		strings.clear();
+		pair = resFork.getResource(STR_LIST_TAG, id);
+		CHECK(pair && !parseStringList(pair.data, pair.length, strings));
+	}
+}
+
+TEST(macRomanEmptyInput) {
+	std::vector<std::string> strings;
+	CHECK(parsePascalStrings(0, 0, 0, strings) && strings.empty());
+	CHECK(!parsePascalStrings(0, 0, 1, strings));
+	CHECK(!parseStringList(0, 0, strings));
+
+	static const byte emptyString[] = { 0 };
+	CHECK(parsePascalStrings(emptyString, 1, 1, strings) && strings.size() == 1 && strings[0].empty());
+}
@@ -0,0 +1,111 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../output.h"
+#include "test.h"
+
+#define TEXT_TAG 0x54455854 // 'TEXT'
+
+TEST(outputPathSanitized) {
+	OutputDirectory outputDir;
+
+	// Resource names are one path component, whatever they contain
+	CHECK(outputDir.getPath("", TEXT_TAG, 128, "Read Me") == "Read Me");
+	CHECK(outputDir.getPath("", TEXT_TAG, 128, "../../etc/passwd") == "..:..:etc:passwd");
+	CHECK(outputDir.getPath("", TEXT_TAG, 128, "/abs") == ":abs");
+	CHECK(outputDir.getPath("", TEXT_TAG, 128, "..") == "_..");
+	CHECK(outputDir.getPath("", TEXT_TAG, 128, ".") == "_.");
+	CHECK(outputDir.getPath("", TEXT_TAG, 128, "") == "_");
+
+	// The prefix is the caller's own
+	CHECK(outputDir.getPath("Volume/Folder/", TEXT_TAG, 128, "a/b") == "Volume/Folder/a:b");
+}
+
+static std::vector<std::string> listDirectory(const std::string &path) {
+	std::vector<std::string> names;
+	DIR *dir = opendir(path.c_str());
+
+	if (dir) {
+		while (struct dirent *entry = readdir(dir))
+			if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+				names.push_back(entry->d_name);
+
+		closedir(dir);
+	}
+
+	return names;
+}
+
+TEST(outputFileCommit) {
+	char rootPath[] = "/tmp/macresview-test.XXXXXX";
+	CHECK(mkdtemp(rootPath) != 0);
+
+	std::string outputPath = std::string(rootPath) + "/out";
+
+	{
+		OutputDirectory outputDir;
+		CHECK(outputDir.open(outputPath, kShardByType));
+
+		std::string path = outputDir.getPath("", TEXT_TAG, 128, "../escape");
+		CHECK(path == "TEXT/..:escape");
+
+		OutputFile outputFile;
+		CHECK(outputFile.open(outputDir, path));
+		CHECK(fputs("contents", outputFile.getFile()) >= 0);
+		CHECK(outputFile.commit());
+
+		// Syncing before linking ends up with the same result
+		outputDir.setSync(true);
+		OutputFile synced;
+		CHECK(synced.open(outputDir, path));
+		CHECK(fputs("contents", synced.getFile()) >= 0);
+		CHECK(synced.commit());
+
+		// Uncommitted files leave nothing behind
+		OutputFile discarded;
+		CHECK(discarded.open(outputDir, "TEXT/discarded"));
+		discarded.discard();
+	}
+
+	std::vector<std::string> names = listDirectory(rootPath);
+	CHECK(names.size() == 1 && names[0] == "out");
+
+	names = listDirectory(outputPath + "/TEXT");
+	CHECK(names.size() == 1 && names[0] == "..:escape");
+
+	std::string filePath = outputPath + "/TEXT/..:escape";
+	FILE *file = fopen(filePath.c_str(), "rb");
+	char contents[16] = { 0 };
+	CHECK(file && fread(contents, 1, sizeof(contents), file) == 8 && !strcmp(contents, "contents"));
+	if (file)
+		fclose(file);
+
+	unlink(filePath.c_str());
+	rmdir((outputPath + "/TEXT").c_str());
+	rmdir(outputPath.c_str());
+	rmdir(rootPath);
+}
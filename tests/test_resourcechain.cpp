@@ -0,0 +1,96 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "../resourcechain.h"
+#include "test.h"
+
+#define ICON_LIST_TAG  0x49434E23 // 'ICN#'
+#define PICT_TAG       0x50494354 // 'PICT'
+#define TEXT_TAG       0x54455854 // 'TEXT'
+#define SMALL_ICON_TAG 0x69637323 // 'ics#'
+
+static bool hasContents(const DataPair &pair, const char *contents) {
+	return pair && pair.length == strlen(contents) && !memcmp(pair.data, contents, pair.length);
+}
+
+// The fixtures come from fixtures/mkfork.py; both have a 'TEXT' 128
+static bool loadChain(ResourceChain &chain) {
+	return chain.addFork(getFixturePath("chain-first.rsrc").c_str()) && chain.addFork(getFixturePath("chain-second.rsrc").c_str());
+}
+
+TEST(chainFirstMatchWins) {
+	ResourceChain chain;
+	CHECK(loadChain(chain));
+	CHECK(chain.getForkCount() == 2);
+	CHECK(chain.getForkName(1) == getFixturePath("chain-second.rsrc"));
+
+	CHECK(hasContents(chain.getResource(TEXT_TAG, 128), "first 128"));
+	CHECK(hasContents(chain.getResource(TEXT_TAG, 130), "second 130"));
+	CHECK(chain.getFilename(TEXT_TAG, 128) == "Shared Name");
+	CHECK(chain.getResourceSize(TEXT_TAG, 128) == strlen("first 128"));
+
+	CHECK(chain.findFork(TEXT_TAG, 128) == chain.getFork(0));
+	CHECK(chain.findFork(TEXT_TAG, 129) == chain.getFork(0));
+	CHECK(chain.findFork(TEXT_TAG, 130) == chain.getFork(1));
+	CHECK(chain.findFork(PICT_TAG, 128) == chain.getFork(1));
+	CHECK(chain.findFork(TEXT_TAG, 131) == 0);
+	CHECK(!chain.getResource(TEXT_TAG, 131));
+}
+
+TEST(chainMergedLists) {
+	ResourceChain chain;
+	CHECK(loadChain(chain));
+
+	// The second fork's 'TEXT' 128 is overridden, so it's listed once
+	std::vector<uint16> ids = chain.getIDArray(TEXT_TAG);
+	CHECK(ids == std::vector<uint16>({ 128, 129, 130 }));
+	CHECK(chain.getIDArray(SMALL_ICON_TAG) == std::vector<uint16>({ 128 }));
+	CHECK(chain.getIDArray(0x534E4420).empty()); // 'SND '
+
+	CHECK(chain.getTagArray() == std::vector<uint32>({ ICON_LIST_TAG, PICT_TAG, TEXT_TAG, SMALL_ICON_TAG }));
+}
+
+TEST(chainNamedResources) {
+	ResourceChain chain;
+	CHECK(loadChain(chain));
+
+	// Both forks have this name, ignoring case, and the first one wins
+	CHECK(hasContents(chain.getResource("SHARED NAME"), "first 128"));
+	CHECK(hasContents(chain.getResource("read me"), "second 130"));
+
+	// Within a type, the other fork's resource of that name is found
+	CHECK(hasContents(chain.getResource(PICT_TAG, "Shared Name"), "picture"));
+	CHECK(hasContents(chain.getResource(TEXT_TAG, "shared name"), "first 128"));
+	CHECK(!chain.getResource(PICT_TAG, "Read Me"));
+
+	// A name still finds a resource whose ID is overridden
+	CHECK(hasContents(chain.getResource("hidden"), "second 128"));
+	CHECK(!chain.getResource("Missing"));
+}
+
+TEST(chainBadFork) {
+	ResourceChain chain;
+	CHECK(!chain.addFork(getFixturePath("missing.rsrc").c_str()));
+	CHECK(chain.getForkCount() == 0 && chain.getTagArray().empty());
+}
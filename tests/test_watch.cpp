@@ -0,0 +1,119 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../watch.h"
+#include "test.h"
+
+static WatchClock::time_point atMilliseconds(WatchClock::time_point start, uint32 milliseconds) {
+	return start + std::chrono::milliseconds(milliseconds);
+}
+
+TEST(watchCoalescesEvents) {
+	WatchPending pending("/incoming", 200);
+	WatchClock::time_point start = WatchClock::now();
+	std::vector<WatchItem> settled;
+
+	CHECK(pending.empty() && pending.getTimeout(start) == -1);
+
+	// A burst of writes to one file is one item, settling after the last
+	pending.update("a.rsrc", start);
+	pending.update("a.rsrc", atMilliseconds(start, 100));
+	pending.update("a.rsrc", atMilliseconds(start, 150));
+	CHECK(pending.size() == 1);
+	CHECK(pending.getTimeout(atMilliseconds(start, 150)) == 201);
+
+	pending.takeSettled(atMilliseconds(start, 300), settled);
+	CHECK(settled.empty());
+
+	pending.takeSettled(atMilliseconds(start, 350), settled);
+	CHECK(settled.size() == 1 && pending.empty());
+	CHECK(settled[0].path == "/incoming/a.rsrc");
+	CHECK(settled[0].firstEvent == start);
+	CHECK(settled[0].queued == atMilliseconds(start, 350));
+
+	// An event after settling starts a new item
+	pending.update("a.rsrc", atMilliseconds(start, 400));
+	CHECK(pending.size() == 1);
+}
+
+TEST(watchDropsRemovedFiles) {
+	WatchPending pending("/incoming/", 200);
+	WatchClock::time_point start = WatchClock::now();
+	std::vector<WatchItem> settled;
+
+	// Upload temporaries renamed away or deleted before settling never run
+	pending.update("upload.tmp", start);
+	pending.update("deleted.rsrc", start);
+	pending.update("kept.rsrc", start);
+	pending.remove("upload.tmp");
+	pending.remove("deleted.rsrc");
+	pending.remove("never-seen.rsrc");
+
+	pending.takeSettled(atMilliseconds(start, 200), settled);
+	CHECK(settled.size() == 1 && settled[0].path == "/incoming/kept.rsrc");
+}
+
+TEST(watchRescan) {
+	char rootPath[] = "/tmp/macresview-test.XXXXXX";
+	CHECK(mkdtemp(rootPath) != 0);
+
+	std::string root = rootPath;
+	std::string filePaths[] = { root + "/first.rsrc", root + "/second.rsrc" };
+
+	for (uint32 i = 0; i < 2; i++) {
+		FILE *file = fopen(filePaths[i].c_str(), "wb");
+		CHECK(file != 0);
+		if (file)
+			fclose(file);
+	}
+
+	std::string folderPath = root + "/folder";
+	CHECK(mkdir(folderPath.c_str(), 0777) == 0);
+
+	WatchPending pending(root, 200);
+	WatchClock::time_point start = WatchClock::now();
+	std::vector<WatchItem> settled;
+
+	// A file with an event before the rescan (as after an overflow) keeps
+	// its timing; the rest count as just arrived, and folders are skipped
+	pending.update("first.rsrc", start);
+	pending.rescan(atMilliseconds(start, 100));
+	CHECK(pending.size() == 2);
+
+	pending.takeSettled(atMilliseconds(start, 200), settled);
+	CHECK(settled.size() == 1 && settled[0].path == filePaths[0]);
+
+	pending.takeSettled(atMilliseconds(start, 300), settled);
+	CHECK(settled.size() == 2 && settled[1].path == filePaths[1]);
+	CHECK(settled[1].firstEvent == atMilliseconds(start, 100));
+
+	for (uint32 i = 0; i < 2; i++)
+		unlink(filePaths[i].c_str());
+
+	rmdir(folderPath.c_str());
+	rmdir(rootPath);
+}
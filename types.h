@@ -58,4 +58,12 @@ typedef signed long int32;
 	#error "Could not detect 32-bit integer type"
 #endif
 
+#if ULONG_MAX == 18446744073709551615UL
+typedef unsigned long uint64;
+typedef signed long int64;
+#else
+typedef unsigned long long uint64;
+typedef signed long long int64;
+#endif
+
 #endif
@@ -21,6 +21,7 @@
  */
 
 #include <ctype.h>
+#include <sys/types.h>
 
 #include "util.h"
 
@@ -75,25 +76,137 @@ void writeUint32BE(FILE *file, uint32 x) {
 	writeUint16BE(file, x & 0xffff);
 }
 
-uint32 getFileSize(FILE *file) {
+void writeUint64LE(FILE *file, uint64 x) {
+	writeUint32LE(file, x & 0xffffffff);
+	writeUint32LE(file, x >> 32);
+}
+
+uint64 getFileSize(FILE *file) {
 	if (!file)
 		return 0;
 
-	uint32 pos = ftell(file);
-	fseek(file, 0, SEEK_END);
-	uint32 size = ftell(file);
-	fseek(file, pos, SEEK_SET);
+	uint64 pos = tellFile(file);
+	fseeko(file, 0, SEEK_END);
+	uint64 size = tellFile(file);
+	seekFile(file, pos);
 	return size;
 }
 
-uint16 READ_UINT16_BE(byte *data) {
+// fseek()/ftell() are limited to a long, which is only 32 bits on some
+// platforms. Use the off_t versions so we can handle images above 4GB.
+bool seekFile(FILE *file, uint64 offset) {
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+}
+
+uint64 tellFile(FILE *file) {
+	off_t pos = ftello(file);
+	return (pos < 0) ? 0 : (uint64)pos;
+}
+
+uint16 READ_UINT16_BE(const byte *data) {
 	return (*data << 8) | *(data + 1);
 }
 
-uint32 READ_UINT32_BE(byte *data) {
+uint32 READ_UINT32_BE(const byte *data) {
 	return (READ_UINT16_BE(data) << 16) | READ_UINT16_BE(data + 2);
 }
 
+uint16 READ_UINT16_LE(const byte *data) {
+	return *data | (*(data + 1) << 8);
+}
+
+uint32 READ_UINT32_LE(const byte *data) {
+	return READ_UINT16_LE(data) | ((uint32)READ_UINT16_LE(data + 2) << 16);
+}
+
+uint64 READ_UINT64_LE(const byte *data) {
+	return READ_UINT32_LE(data) | ((uint64)READ_UINT32_LE(data + 4) << 32);
+}
+
+void WRITE_UINT16_BE(byte *data, uint16 x) {
+	data[0] = x >> 8;
+	data[1] = x & 0xff;
+}
+
+void WRITE_UINT32_BE(byte *data, uint32 x) {
+	data[0] = x >> 24;
+	data[1] = (x >> 16) & 0xff;
+	data[2] = (x >> 8) & 0xff;
+	data[3] = x & 0xff;
+}
+
+struct CRC16Table {
+	CRC16Table() {
+		for (uint32 i = 0; i < 256; i++) {
+			uint16 crc = i << 8;
+
+			for (int j = 0; j < 8; j++)
+				crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+
+			entries[i] = crc;
+		}
+	}
+
+	uint16 entries[256];
+};
+
+uint16 updateCRC16(uint16 crc, const byte *data, uint32 length) {
+	static const CRC16Table table;
+
+	for (uint32 i = 0; i < length; i++)
+		crc = (crc << 8) ^ table.entries[(crc >> 8) ^ data[i]];
+
+	return crc;
+}
+
+uint64 updateHash(uint64 hash, const byte *data, uint32 length) {
+	for (uint32 i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * 0x100000001B3ULL;
+
+	return hash;
+}
+
+std::string tagToString(uint32 tag) {
+	char str[4] = { (char)(tag >> 24), (char)(tag >> 16), (char)(tag >> 8), (char)tag };
+	return std::string(str, 4);
+}
+
+std::string sanitizeName(std::string name) {
+	for (uint32 i = 0; i < name.size(); i++)
+		if (name[i] == '/' || name[i] == 0)
+			name[i] = ':';
+
+	if (name.empty() || name == "." || name == "..")
+		name = "_" + name;
+
+	return name;
+}
+
+std::string escapeJSONString(const std::string &str) {
+	std::string result = "\"";
+
+	for (uint32 i = 0; i < str.size(); i++) {
+		byte c = str[i];
+
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (c == '\n') {
+			result += "\\n";
+		} else if (c == '\t') {
+			result += "\\t";
+		} else if (c < 0x20) {
+			char escape[8];
+			sprintf(escape, "\\u%04x", c);
+			result += escape;
+		} else {
+			result += c;
+		}
+	}
+
+	return result + "\"";
+}
+
 // A very simple function to compare strings while ignoring case
 int compareStringIgnoreCase(const char *s1, const char *s2) {
     for(; tolower((byte)(*s1)) == tolower((byte)(*s2)); ++s1, ++s2)
@@ -24,12 +24,18 @@
 #define UTIL_H
 
 #include <stdio.h>
+#include <string>
 #include "types.h"
 
 // A few assorted endian, file, and string related functions
 
-uint16 READ_UINT16_BE(byte *data);
-uint32 READ_UINT32_BE(byte *data);
+uint16 READ_UINT16_BE(const byte *data);
+uint32 READ_UINT32_BE(const byte *data);
+uint16 READ_UINT16_LE(const byte *data);
+uint32 READ_UINT32_LE(const byte *data);
+uint64 READ_UINT64_LE(const byte *data);
+void WRITE_UINT16_BE(byte *data, uint16 x);
+void WRITE_UINT32_BE(byte *data, uint32 x);
 
 byte readByte(FILE *file);
 uint16 readUint16LE(FILE *file);
@@ -41,8 +47,28 @@ void writeUint16LE(FILE *file, uint16 x);
 void writeUint32LE(FILE *file, uint32 x);
 void writeUint16BE(FILE *file, uint16 x);
 void writeUint32BE(FILE *file, uint32 x);
+void writeUint64LE(FILE *file, uint64 x);
 
-uint32 getFileSize(FILE *file);
+uint64 getFileSize(FILE *file);
+bool seekFile(FILE *file, uint64 offset);
+uint64 tellFile(FILE *file);
+
+// CRC-16/CCITT as used by BinHex and MacBinary II
+uint16 updateCRC16(uint16 crc, const byte *data, uint32 length);
+
+// 64-bit FNV-1a, which can be fed a buffer in pieces
+#define HASH_INITIAL_VALUE 0xCBF29CE484222325ULL
+uint64 updateHash(uint64 hash, const byte *data, uint32 length);
+
+// Four-character resource type code as a (Mac Roman) string
+std::string tagToString(uint32 tag);
+
+// Make a Mac file or resource name usable as a single path component: Mac
+// names can contain '/', and "." or ".." would point somewhere else
+std::string sanitizeName(std::string name);
+
+// Quote a UTF-8 string for JSON output
+std::string escapeJSONString(const std::string &str);
 
 int compareStringIgnoreCase(const char *s1, const char *s2);
 
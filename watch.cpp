@@ -0,0 +1,312 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "watch.h"
+
+static double getMilliseconds(WatchClock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+WatchPending::WatchPending(const std::string &directory, uint32 settleTime) {
+	_directory = directory;
+	_prefix = directory;
+	if (_prefix.empty() || _prefix[_prefix.size() - 1] != '/')
+		_prefix += '/';
+
+	_settleDuration = std::chrono::milliseconds(settleTime);
+}
+
+void WatchPending::update(const std::string &name, WatchClock::time_point now) {
+	std::string path = _prefix + name;
+	std::map<std::string, WatchItem>::iterator it = _items.find(path);
+
+	if (it != _items.end()) {
+		it->second.lastEvent = now;
+		return;
+	}
+
+	WatchItem item;
+	item.path = path;
+	item.firstEvent = now;
+	item.lastEvent = now;
+	_items[path] = item;
+}
+
+void WatchPending::remove(const std::string &name) {
+	_items.erase(_prefix + name);
+}
+
+void WatchPending::rescan(WatchClock::time_point now) {
+	DIR *dir = opendir(_directory.c_str());
+	if (!dir) {
+		fprintf(stderr, "Failed to open directory '%s'\n", _directory.c_str());
+		return;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != 0) {
+		std::string path = _prefix + entry->d_name;
+		unsigned char type = entry->d_type;
+
+		// Not every file system fills in the type
+		if (type == DT_UNKNOWN) {
+			struct stat status;
+			if (lstat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode))
+				type = DT_REG;
+		}
+
+		if (type == DT_REG && _items.find(path) == _items.end())
+			update(entry->d_name, now);
+	}
+
+	closedir(dir);
+}
+
+int WatchPending::getTimeout(WatchClock::time_point now) const {
+	if (_items.empty())
+		return -1;
+
+	WatchClock::time_point nextSettled = WatchClock::time_point::max();
+
+	for (std::map<std::string, WatchItem>::const_iterator it = _items.begin(); it != _items.end(); it++)
+		if (it->second.lastEvent + _settleDuration < nextSettled)
+			nextSettled = it->second.lastEvent + _settleDuration;
+
+	double wait = getMilliseconds(nextSettled - now);
+	return (wait > 0) ? (int)wait + 1 : 0;
+}
+
+void WatchPending::takeSettled(WatchClock::time_point now, std::vector<WatchItem> &settled) {
+	for (std::map<std::string, WatchItem>::iterator it = _items.begin(); it != _items.end();) {
+		if (it->second.lastEvent + _settleDuration <= now) {
+			settled.push_back(it->second);
+			settled.back().queued = now;
+			_items.erase(it++);
+		} else {
+			it++;
+		}
+	}
+}
+
+#ifdef __linux__
+
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <mutex>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+
+struct WatchQueue {
+	WatchProc proc;
+	void *context;
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<WatchItem> items;
+	bool finished;
+
+	// Latency totals, in milliseconds
+	uint32 processedCount;
+	double totalLatency;
+	double maxLatency;
+};
+
+static volatile sig_atomic_t s_stopWatching = 0;
+
+static void stopWatching(int) {
+	s_stopWatching = 1;
+}
+
+static void processWatchItems(WatchQueue *queue) {
+	for (;;) {
+		WatchItem item;
+
+		{
+			std::unique_lock<std::mutex> lock(queue->mutex);
+
+			while (queue->items.empty() && !queue->finished)
+				queue->ready.wait(lock);
+
+			if (queue->items.empty())
+				break;
+
+			item = queue->items.front();
+			queue->items.pop_front();
+		}
+
+		WatchClock::time_point started = WatchClock::now();
+		queue->proc(item.path, queue->context);
+		WatchClock::time_point done = WatchClock::now();
+
+		double latency = getMilliseconds(done - item.firstEvent);
+
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		printf("%s: %.1f ms (%.1f settling, %.1f queued, %.1f processing)\n", item.path.c_str(), latency,
+				getMilliseconds(item.queued - item.firstEvent), getMilliseconds(started - item.queued), getMilliseconds(done - started));
+		fflush(stdout);
+
+		queue->processedCount++;
+		queue->totalLatency += latency;
+		if (latency > queue->maxLatency)
+			queue->maxLatency = latency;
+	}
+}
+
+bool watchDirectory(const std::string &directory, uint jobCount, uint32 settleTime, WatchProc proc, void *context) {
+	int fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to start inotify: %s\n", strerror(errno));
+		return false;
+	}
+
+	// Only finished files: written and closed, or renamed into place. Files
+	// renamed away or deleted before settling (upload temporaries) are dropped.
+	if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR) < 0) {
+		fprintf(stderr, "Failed to watch '%s': %s\n", directory.c_str(), strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	WatchQueue queue;
+	queue.proc = proc;
+	queue.context = context;
+	queue.finished = false;
+	queue.processedCount = 0;
+	queue.totalLatency = 0;
+	queue.maxLatency = 0;
+
+	if (jobCount == 0)
+		jobCount = 1;
+
+	std::vector<std::thread> threads;
+	for (uint i = 0; i < jobCount; i++)
+		threads.push_back(std::thread(processWatchItems, &queue));
+
+	s_stopWatching = 0;
+	signal(SIGINT, stopWatching);
+	signal(SIGTERM, stopWatching);
+
+	printf("Watching '%s'; interrupt to stop\n", directory.c_str());
+	fflush(stdout);
+
+	// Files with recent events, waiting for things to settle. Whatever was
+	// there before the watch started counts as having just arrived.
+	WatchPending pending(directory, settleTime);
+	pending.rescan(WatchClock::now());
+
+	// Big enough for plenty of events, and aligned for struct inotify_event
+	alignas(struct inotify_event) char buffer[64 * 1024];
+
+	while (!s_stopWatching) {
+		// Sleep until the next pending file settles, or for good if none are
+		int timeout = pending.getTimeout(WatchClock::now());
+
+		struct pollfd pollFD;
+		pollFD.fd = fd;
+		pollFD.events = POLLIN;
+
+		int result = poll(&pollFD, 1, timeout);
+
+		if (result < 0 && errno != EINTR) {
+			fprintf(stderr, "Failed to wait for events: %s\n", strerror(errno));
+			break;
+		}
+
+		WatchClock::time_point now = WatchClock::now();
+
+		if (result > 0) {
+			ssize_t length = read(fd, buffer, sizeof(buffer));
+
+			for (ssize_t offset = 0; offset < length;) {
+				const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+				offset += sizeof(struct inotify_event) + event->len;
+
+				// The kernel's queue filled up and events were lost, so any
+				// file could have arrived unseen. Going over the whole
+				// directory may process some files twice, but misses none.
+				if (event->mask & IN_Q_OVERFLOW) {
+					fprintf(stderr, "Missed events watching '%s'; rescanning it\n", directory.c_str());
+					pending.rescan(now);
+					continue;
+				}
+
+				if (event->len == 0 || (event->mask & IN_ISDIR))
+					continue;
+
+				if (event->mask & (IN_MOVED_FROM | IN_DELETE))
+					pending.remove(event->name);
+				else
+					pending.update(event->name, now);
+			}
+		}
+
+		// Queue everything that has gone quiet
+		std::vector<WatchItem> settled;
+		pending.takeSettled(now, settled);
+
+		if (!settled.empty()) {
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.items.insert(queue.items.end(), settled.begin(), settled.end());
+			queue.ready.notify_all();
+		}
+	}
+
+	// Let the workers finish what's already queued
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.finished = true;
+		queue.ready.notify_all();
+	}
+
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	close(fd);
+
+	if (!pending.empty())
+		printf("\nDropped %d files that were still being written\n", (int)pending.size());
+
+	if (queue.processedCount != 0)
+		printf("\nProcessed %d files, latency %.1f ms average, %.1f ms worst\n", queue.processedCount, queue.totalLatency / queue.processedCount, queue.maxLatency);
+
+	return true;
+}
+
+#else
+
+bool watchDirectory(const std::string &directory, uint jobCount, uint32 settleTime, WatchProc proc, void *context) {
+	fprintf(stderr, "Watching directories needs inotify, which only Linux has\n");
+	return false;
+}
+
+#endif
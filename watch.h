@@ -0,0 +1,84 @@
+/* macresview - A simple Mac resource fork dumper
+ *
+ * macresview is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "types.h"
+
+typedef std::chrono::steady_clock WatchClock;
+
+struct WatchItem {
+	std::string path;
+	WatchClock::time_point firstEvent; // Latency is measured from here
+	WatchClock::time_point lastEvent;
+	WatchClock::time_point queued;
+};
+
+// Files in a watched directory with recent events, waiting for things to
+// settle. Times are passed in rather than read from the clock, so the
+// coalescing can be driven (and tested) without real delays.
+class WatchPending {
+public:
+	WatchPending(const std::string &directory, uint32 settleTime);
+
+	// A file was written or moved in; repeated events push its settling back
+	void update(const std::string &name, WatchClock::time_point now);
+
+	// A file was moved away or deleted before it settled
+	void remove(const std::string &name);
+
+	// Treat every regular file in the directory as if it had just arrived;
+	// files already pending keep their timing
+	void rescan(WatchClock::time_point now);
+
+	// Milliseconds until the next file settles, or -1 if none are pending
+	int getTimeout(WatchClock::time_point now) const;
+
+	// Move every file that has gone quiet into settled, marked as queued now
+	void takeSettled(WatchClock::time_point now, std::vector<WatchItem> &settled);
+
+	uint32 size() const { return _items.size(); }
+	bool empty() const { return _items.empty(); }
+
+private:
+	std::string _directory;
+	std::string _prefix;
+	WatchClock::duration _settleDuration;
+	std::map<std::string, WatchItem> _items;
+};
+
+// Called from a worker thread for each file that has finished arriving
+typedef void (*WatchProc)(const std::string &path, void *context);
+
+// Hand every file already in directory, and each one written or moved into
+// it afterwards, to proc on one of jobCount workers. Events for the same file that come
+// within settleTime milliseconds of each other are coalesced into one.
+// Runs until interrupted (SIGINT/SIGTERM), then drains the queue and
+// prints latency figures. Only available on Linux, through inotify.
+bool watchDirectory(const std::string &directory, uint jobCount, uint32 settleTime, WatchProc proc, void *context);
+
+#endif